@@ -0,0 +1,205 @@
+
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include "core.h"
+#include "mem_pool.h"
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <stdlib.h>
+#include <string.h>
+
+CORE_NAMESPACE_BEG
+
+/// <summary>
+/// types whose objects can be moved to another address with memcpy, leaving nothing to destroy behind.
+/// specialize it for types that own heap memory but hold no pointer into themselves
+/// </summary>
+template<typename _T>
+struct is_trivially_relocatable : std::is_trivially_copyable<_T> {};
+
+/// <summary>
+/// arrays go through the size-dispatched pool path, sizes beyond the largest cell fall back to malloc so they can grow with realloc
+/// </summary>
+struct _allocator_array {
+    static const size_t MaxPoolUserMemSize = mem_pool::info_for_global::max_cell_user_mem_size;
+
+    inline static void* alloc(size_t size)
+    {
+        if (MaxPoolUserMemSize < size)
+        {
+            auto p = ::malloc(size);
+            if (nullptr == p)
+            {
+                throw std::bad_alloc();
+            }
+            return p;
+        }
+        return mem_pool_utils::alloc(size);
+    }
+    inline static void free(void* p, size_t size)
+    {
+        if (MaxPoolUserMemSize < size)
+        {
+            ::free(p);
+            return;
+        }
+        mem_pool_utils::free(p);
+    }
+    /// <summary>
+    /// keeps the bytes of p, stays in place when the cell size or the malloc span allows
+    /// </summary>
+    static void* realloc(void* p, size_t old_size, size_t new_size)
+    {
+        if (nullptr == p)
+        {
+            return alloc(new_size);
+        }
+        if (MaxPoolUserMemSize < old_size && MaxPoolUserMemSize < new_size)
+        {
+            auto new_p = ::realloc(p, new_size);
+            if (nullptr == new_p)
+            {
+                throw std::bad_alloc();
+            }
+            return new_p;
+        }
+        if (MaxPoolUserMemSize >= old_size && MaxPoolUserMemSize >= new_size)
+        {
+            return mem_pool_utils::realloc(p, new_size);
+        }
+        // crossing between the pool and malloc
+        auto new_p = alloc(new_size);
+        memcpy(new_p, p, old_size < new_size ? old_size : new_size);
+        free(p, old_size);
+        return new_p;
+    }
+};
+
+/// <summary>
+/// single elements (the nodes of map, set, list, unordered_map) go straight to the typed pool of sizeof(_T)
+/// </summary>
+template<typename _T, bool _IsPoolCell = (mem_pool::info_for_type<_T>::pool_index < mem_cell::PoolCount)>
+struct _allocator_single {
+    inline static void* alloc()
+    {
+        return mem_pool_utils::alloc<_T>();
+    }
+    inline static void free(void* p)
+    {
+        mem_pool_utils::free<_T>(p);
+    }
+};
+template<typename _T>
+struct _allocator_single<_T, false> {
+    inline static void* alloc()
+    {
+        return _allocator_array::alloc(sizeof(_T));
+    }
+    inline static void free(void* p)
+    {
+        _allocator_array::free(p, sizeof(_T));
+    }
+};
+
+template<typename _T>
+class allocator
+{
+public:
+    using value_type = _T;
+    using pointer = _T*;
+    using const_pointer = const _T*;
+    using void_pointer = void*;
+    using const_void_pointer = const void*;
+    using reference = _T&;
+    using const_reference = const _T&;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+
+    template<typename _U>
+    struct rebind { using other = allocator<_U>; };
+
+    allocator() = default;
+    ~allocator() = default;
+    allocator(const allocator&) noexcept {};
+    template<typename _U>
+    allocator(const allocator<_U>&) noexcept {};
+    allocator& operator =(const allocator&) = delete;
+
+    inline pointer allocate(size_type count)
+    {
+        if (1 == count)
+        {
+            return static_cast<pointer>(_allocator_single<_T>::alloc());
+        }
+        return static_cast<pointer>(_allocator_array::alloc(sizeof(_T) * count));
+    }
+
+    inline pointer allocate(size_type count, const_void_pointer hit)
+    {
+        hit;
+        return allocate(count);
+    }
+
+    inline void deallocate(pointer p, size_type count)
+    {
+        if (1 == count)
+        {
+            _allocator_single<_T>::free(p);
+            return;
+        }
+        _allocator_array::free(p, sizeof(_T) * count);
+    }
+
+    /// <summary>
+    /// resizes memory from allocate(old_count) without constructing anything, only for is_trivially_relocatable types.
+    /// the typed single path shares its cells with the array path, so any count pair works
+    /// </summary>
+    inline pointer reallocate(pointer p, size_type old_count, size_type new_count)
+    {
+        static_assert(is_trivially_relocatable<_T>::value, "_T must be trivially relocatable");
+        return static_cast<pointer>(_allocator_array::realloc(p, sizeof(_T) * old_count, sizeof(_T) * new_count));
+    }
+
+    template<typename _U, typename ...Args>
+    inline void construct(_U* const p, Args&&... args)
+    {
+        ::new(p) _U(std::forward<Args>(args)...);
+    }
+
+    template <typename _U>
+    inline void destroy(_U* const p)
+    {
+        p->~_U();
+    }
+
+    inline pointer address(reference x)
+    {
+        return (pointer)&x;
+    }
+
+    inline const_pointer address(const_reference x)
+    {
+        return (const_pointer)&x;
+    }
+
+    inline size_type max_size() const
+    {
+        return static_cast<size_type>(-1) / sizeof(_T);
+    }
+};
+template <class _T, class _P>
+inline bool operator==(const allocator<_T>&, const allocator<_P>&) noexcept
+{
+    return true;
+}
+template <class _T, class _P>
+inline bool operator!=(const allocator<_T>&, const allocator<_P>&) noexcept
+{
+    return false;
+}
+
+CORE_NAMESPACE_END
+
+#endif
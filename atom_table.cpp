@@ -0,0 +1,161 @@
+
+#include "atom_table.h"
+#include "allocator.h"
+#include "environment.h"
+#include "bug_reporter.h"
+#include <string.h>
+#include <new>
+
+CORE_NAMESPACE_BEG
+
+atom_table::atom_table()
+	: _pages()
+	, _cur_index(nullptr)
+	, _retired_indexes(nullptr)
+	, _count(0)
+	, _mutex()
+{
+
+}
+
+atom_table::~atom_table()
+{
+	auto count = _count.load(std::memory_order_relaxed);
+	for (uint32_t id = 1; id <= count; ++id)
+	{
+		auto e = _entry_of(id);
+		_allocator_array::free(e, offsetof(_entry, chars) + e->length + 1);
+	}
+	for (size_t i = 0; i < _MaxPageCount && nullptr != _pages[i]; ++i)
+	{
+		_allocator_array::free(_pages[i], sizeof(_entry*) * _PageSize);
+	}
+
+	_free_index(_cur_index.load(std::memory_order_relaxed));
+	while (nullptr != _retired_indexes)
+	{
+		auto next = _retired_indexes->retired_next;
+		_free_index(_retired_indexes);
+		_retired_indexes = next;
+	}
+}
+
+atom atom_table::intern(std::string_view name)
+{
+	auto hash = _hash_of(name);
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto index = _cur_index.load(std::memory_order_relaxed);
+	if (nullptr != index)
+	{
+		auto a = _find(index, name, hash);
+		if (!a.is_null())
+		{
+			return a;
+		}
+	}
+
+	auto count = _count.load(std::memory_order_relaxed);
+	if (MaxAtomCount <= count)
+	{
+		environment::get_cur_bug_reporter().report(BUG_TAG_ATOM_TABLE, "atom_table is full");
+		return atom();
+	}
+	auto id = count + 1;
+
+	auto e = static_cast<_entry*>(_allocator_array::alloc(offsetof(_entry, chars) + name.size() + 1));
+	e->hash = hash;
+	e->length = static_cast<uint32_t>(name.size());
+	memcpy(e->chars, name.data(), name.size());
+	e->chars[name.size()] = '\0';
+
+	auto& page = _pages[id >> _PageBits];
+	if (nullptr == page)
+	{
+		page = static_cast<_entry**>(_allocator_array::alloc(sizeof(_entry*) * _PageSize));
+		memset(page, 0, sizeof(_entry*) * _PageSize);
+	}
+	page[id & (_PageSize - 1)] = e;
+
+	if (nullptr == index || (static_cast<size_t>(id) * 2 > index->mask + 1))
+	{
+		auto new_index = _new_index(nullptr == index ? _MinIndexSize : (index->mask + 1) * 2);
+		for (uint32_t i = 1; i < id; ++i)
+		{
+			_insert(new_index, i, _entry_of(i)->hash);
+		}
+		if (nullptr != index)
+		{
+			index->retired_next = _retired_indexes;
+			_retired_indexes = index;
+		}
+		index = new_index;
+		_cur_index.store(index, std::memory_order_release);
+	}
+
+	// publishing the id in a slot makes the entry and its page visible to readers
+	_insert(index, id, hash);
+	_count.store(id, std::memory_order_release);
+	return atom(id);
+}
+
+atom atom_table::find(std::string_view name) const
+{
+	auto index = _cur_index.load(std::memory_order_acquire);
+	if (nullptr == index)
+	{
+		return atom();
+	}
+	return _find(index, name, _hash_of(name));
+}
+
+atom atom_table::_find(const _index* index, std::string_view name, size_t hash) const
+{
+	for (auto i = hash & index->mask;; i = (i + 1) & index->mask)
+	{
+		auto id = index->slots[i].load(std::memory_order_acquire);
+		if (0 == id)
+		{
+			return atom();
+		}
+		auto e = _entry_of(id);
+		if (hash == e->hash && name == e->name())
+		{
+			return atom(id);
+		}
+	}
+}
+
+void atom_table::_insert(_index* index, uint32_t id, size_t hash)
+{
+	auto i = hash & index->mask;
+	while (0 != index->slots[i].load(std::memory_order_relaxed))
+	{
+		i = (i + 1) & index->mask;
+	}
+	index->slots[i].store(id, std::memory_order_release);
+}
+
+atom_table::_index* atom_table::_new_index(size_t size)
+{
+	auto index = static_cast<_index*>(_allocator_array::alloc(sizeof(_index)));
+	index->retired_next = nullptr;
+	index->mask = size - 1;
+	index->slots = static_cast<std::atomic<uint32_t>*>(_allocator_array::alloc(sizeof(std::atomic<uint32_t>) * size));
+	for (size_t i = 0; i < size; ++i)
+	{
+		::new(static_cast<void*>(index->slots + i)) std::atomic<uint32_t>(0);
+	}
+	return index;
+}
+
+void atom_table::_free_index(_index* index)
+{
+	if (nullptr == index)
+	{
+		return;
+	}
+	_allocator_array::free(index->slots, sizeof(std::atomic<uint32_t>) * (index->mask + 1));
+	_allocator_array::free(index, sizeof(_index));
+}
+
+CORE_NAMESPACE_END
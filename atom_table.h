@@ -0,0 +1,125 @@
+
+#ifndef ATOM_TABLE_H
+#define ATOM_TABLE_H
+
+#include "core.h"
+#include "noncopyable.h"
+#include <atomic>
+#include <mutex>
+#include <string_view>
+#include <functional>
+
+CORE_NAMESPACE_BEG
+
+/// <summary>
+/// 32-bit handle of an interned string, compares and hashes as an integer.
+/// the default atom is null and names nothing
+/// </summary>
+class atom {
+	uint32_t _id;
+
+public:
+	inline constexpr atom() : _id(0) {}
+	inline constexpr explicit atom(uint32_t id) : _id(id) {}
+
+public:
+	inline constexpr uint32_t id() const { return _id; }
+	inline constexpr bool is_null() const { return 0 == _id; }
+
+	inline constexpr bool operator==(atom rhs) const { return _id == rhs._id; }
+	inline constexpr bool operator!=(atom rhs) const { return _id != rhs._id; }
+	inline constexpr bool operator<(atom rhs) const { return _id < rhs._id; }
+	inline constexpr bool operator>(atom rhs) const { return _id > rhs._id; }
+	inline constexpr bool operator<=(atom rhs) const { return _id <= rhs._id; }
+	inline constexpr bool operator>=(atom rhs) const { return _id >= rhs._id; }
+};
+
+/// <summary>
+/// interns strings into immutable pool memory that lives as long as the table.
+/// find and name_of are lock-free and may run on any thread; intern takes a mutex and allocates through mem_pool_utils,
+/// so call it on the thread that owns the pool.
+/// replaced hash indexes are kept until the table dies, a reader may still be probing one
+/// </summary>
+class atom_table final : noncopyable {
+	struct _entry {
+		size_t hash;
+		uint32_t length;
+		// null terminated
+		char chars[1];
+
+		inline std::string_view name() const { return std::string_view(chars, length); }
+	};
+
+	// open addressing over atom ids, 0 marks an empty slot, load stays at or below 1/2
+	struct _index {
+		_index* retired_next;
+		size_t mask;
+		std::atomic<uint32_t>* slots;
+	};
+
+	static const size_t _PageBits = 10;
+	static const size_t _PageSize = size_t(1) << _PageBits;
+	static const size_t _MaxPageCount = 4096;
+	static const size_t _MinIndexSize = 64;
+
+	// entries by id, a page is written once before any id on it is published
+	_entry** _pages[_MaxPageCount];
+	std::atomic<_index*> _cur_index;
+	_index* _retired_indexes;
+	std::atomic<uint32_t> _count;
+	std::mutex _mutex;
+
+public:
+	static const size_t MaxAtomCount = _PageSize * _MaxPageCount - 1;
+
+	atom_table();
+	~atom_table();
+
+public:
+	/// <summary>
+	/// the atom of name, added if it is not in the table yet
+	/// </summary>
+	atom intern(std::string_view name);
+	/// <summary>
+	/// lock-free, returns a null atom if name was never interned
+	/// </summary>
+	atom find(std::string_view name) const;
+	/// <summary>
+	/// lock-free, the view stays valid (and null terminated) as long as the table
+	/// </summary>
+	inline std::string_view name_of(atom a) const
+	{
+		return a.is_null() ? std::string_view() : _entry_of(a.id())->name();
+	}
+
+	inline size_t size() const { return _count.load(std::memory_order_acquire); }
+
+private:
+	inline _entry* _entry_of(uint32_t id) const
+	{
+		return _pages[id >> _PageBits][id & (_PageSize - 1)];
+	}
+	inline static size_t _hash_of(std::string_view name)
+	{
+		auto h = static_cast<uint64_t>(std::hash<std::string_view>()(name)) * 0x9E3779B97F4A7C15ull;
+		return static_cast<size_t>(h ^ (h >> 32));
+	}
+
+	atom _find(const _index* index, std::string_view name, size_t hash) const;
+	void _insert(_index* index, uint32_t id, size_t hash);
+	_index* _new_index(size_t size);
+	void _free_index(_index* index);
+};
+
+CORE_NAMESPACE_END
+
+namespace std {
+
+	template<>
+	struct hash<CORE atom>
+	{
+		inline size_t operator()(CORE atom a) const { return static_cast<size_t>(a.id()); }
+	};
+}
+
+#endif
@@ -0,0 +1,907 @@
+
+#ifndef BTREE_MAP_H
+#define BTREE_MAP_H
+
+#include "core.h"
+#include "allocator.h"
+#include "sfinae_macros.h"
+#include <memory>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <tuple>
+#include <iterator>
+#include <initializer_list>
+#include <stdexcept>
+#include <new>
+
+CORE_NAMESPACE_BEG
+
+constexpr size_t _btree_node_capacity(size_t count)
+{
+	return 3 > count ? 3 : count;
+}
+
+/// <summary>
+/// B+tree shared by btree_map and btree_set. values live only in the leaves, which are linked for iteration,
+/// inner nodes hold copies of the separating keys. each node is about NodeTargetSize bytes and comes from one pool cell.
+/// iterators are invalidated by insert and erase
+/// </summary>
+template<typename _Key, typename _Value, typename _KeyOf, typename _Compare, typename _Alloc>
+class _btree {
+	struct _internal_node;
+
+	struct _node {
+		_internal_node* parent;
+		uint16_t pos;
+		uint16_t count;
+		bool is_leaf;
+	};
+
+public:
+	static const size_t NodeTargetSize = 256;
+	static const size_t LeafCapacity = _btree_node_capacity((NodeTargetSize - sizeof(_node) - 2 * sizeof(void*)) / sizeof(_Value));
+	static const size_t InternalCapacity = _btree_node_capacity((NodeTargetSize - sizeof(_node) - sizeof(void*)) / (sizeof(_Key) + sizeof(void*)));
+
+private:
+	static const size_t _MinLeafCount = LeafCapacity / 2;
+	static const size_t _MinInternalCount = InternalCapacity / 2;
+
+	struct _leaf_node : _node {
+		_leaf_node* prev;
+		_leaf_node* next;
+		alignas(_Value) unsigned char slot_buf[sizeof(_Value) * LeafCapacity];
+
+		inline _Value* slots() { return reinterpret_cast<_Value*>(slot_buf); }
+	};
+	struct _internal_node : _node {
+		_node* children[InternalCapacity + 1];
+		alignas(_Key) unsigned char key_buf[sizeof(_Key) * InternalCapacity];
+
+		inline _Key* keys() { return reinterpret_cast<_Key*>(key_buf); }
+	};
+
+	using _alloc_traits = std::allocator_traits<_Alloc>;
+	using _leaf_allocator_type = typename _alloc_traits::template rebind_alloc<_leaf_node>;
+	using _internal_allocator_type = typename _alloc_traits::template rebind_alloc<_internal_node>;
+
+public:
+	using key_type = _Key;
+	using value_type = _Value;
+	using size_type = size_t;
+	using difference_type = std::ptrdiff_t;
+	using key_compare = _Compare;
+	using allocator_type = _Alloc;
+	using reference = value_type&;
+	using const_reference = const value_type&;
+
+	template<typename _V>
+	class _iterator {
+		friend class _btree;
+		template<typename _U>
+		friend class _iterator;
+
+		_leaf_node* _leaf;
+		size_t _pos;
+
+		inline _iterator(_leaf_node* leaf, size_t pos) : _leaf(leaf), _pos(pos) {}
+
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = typename std::remove_const<_V>::type;
+		using difference_type = std::ptrdiff_t;
+		using pointer = _V*;
+		using reference = _V&;
+
+		inline _iterator() : _leaf(nullptr), _pos(0) {}
+		template<typename _U, enable_if_int<std::is_convertible<_U*, _V*>::value> = 0>
+		inline _iterator(const _iterator<_U>& other) : _leaf(other._leaf), _pos(other._pos) {}
+
+		inline reference operator*() const { return _leaf->slots()[_pos]; }
+		inline pointer operator->() const { return _leaf->slots() + _pos; }
+		inline _iterator& operator++()
+		{
+			if (++_pos == _leaf->count && nullptr != _leaf->next)
+			{
+				_leaf = _leaf->next;
+				_pos = 0;
+			}
+			return *this;
+		}
+		inline _iterator operator++(int)
+		{
+			auto tmp = *this;
+			++*this;
+			return tmp;
+		}
+		inline _iterator& operator--()
+		{
+			if (0 == _pos)
+			{
+				_leaf = _leaf->prev;
+				_pos = _leaf->count;
+			}
+			--_pos;
+			return *this;
+		}
+		inline _iterator operator--(int)
+		{
+			auto tmp = *this;
+			--*this;
+			return tmp;
+		}
+		inline bool operator==(const _iterator& rhs) const { return _leaf == rhs._leaf && _pos == rhs._pos; }
+		inline bool operator!=(const _iterator& rhs) const { return !operator==(rhs); }
+	};
+	using iterator = _iterator<value_type>;
+	using const_iterator = _iterator<const value_type>;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+private:
+	_node* _root;
+	_leaf_node* _leftmost;
+	_leaf_node* _rightmost;
+	size_t _size;
+	_Compare _comp;
+	_Alloc _alloc;
+
+public:
+	inline explicit _btree(const _Compare& comp = _Compare(), const _Alloc& alloc = _Alloc())
+		: _root(nullptr)
+		, _leftmost(nullptr)
+		, _rightmost(nullptr)
+		, _size(0)
+		, _comp(comp)
+		, _alloc(alloc)
+	{
+	}
+	_btree(const _btree& other)
+		: _btree(other._comp, other._alloc)
+	{
+		// values come in order, every insert lands in the rightmost leaf
+		for (auto& v : other)
+		{
+			_emplace_key(_KeyOf::get(v), v);
+		}
+	}
+	_btree(_btree&& other) noexcept
+		: _root(other._root)
+		, _leftmost(other._leftmost)
+		, _rightmost(other._rightmost)
+		, _size(other._size)
+		, _comp(std::move(other._comp))
+		, _alloc(std::move(other._alloc))
+	{
+		other._root = nullptr;
+		other._leftmost = nullptr;
+		other._rightmost = nullptr;
+		other._size = 0;
+	}
+	~_btree()
+	{
+		clear();
+	}
+
+	_btree& operator=(const _btree& other)
+	{
+		if (this != &other)
+		{
+			_btree(other).swap(*this);
+		}
+		return *this;
+	}
+	_btree& operator=(_btree&& other) noexcept
+	{
+		if (this != &other)
+		{
+			_btree(std::move(other)).swap(*this);
+		}
+		return *this;
+	}
+
+	void swap(_btree& other) noexcept
+	{
+		std::swap(_root, other._root);
+		std::swap(_leftmost, other._leftmost);
+		std::swap(_rightmost, other._rightmost);
+		std::swap(_size, other._size);
+		std::swap(_comp, other._comp);
+		// allocators are not swapped, _Alloc must compare equal across trees like core::allocator does
+	}
+
+public:
+	inline iterator begin() { return iterator(_leftmost, 0); }
+	inline const_iterator begin() const { return const_iterator(_leftmost, 0); }
+	inline const_iterator cbegin() const { return begin(); }
+	inline iterator end() { return iterator(_rightmost, nullptr == _rightmost ? 0 : _rightmost->count); }
+	inline const_iterator end() const { return const_iterator(_rightmost, nullptr == _rightmost ? 0 : _rightmost->count); }
+	inline const_iterator cend() const { return end(); }
+	inline reverse_iterator rbegin() { return reverse_iterator(end()); }
+	inline const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+	inline reverse_iterator rend() { return reverse_iterator(begin()); }
+	inline const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+	inline size_t size() const { return _size; }
+	inline bool empty() const { return 0 == _size; }
+	inline key_compare key_comp() const { return _comp; }
+	inline allocator_type get_allocator() const { return _alloc; }
+
+	void clear()
+	{
+		if (nullptr != _root)
+		{
+			_destroy_subtree(_root);
+		}
+		_root = nullptr;
+		_leftmost = nullptr;
+		_rightmost = nullptr;
+		_size = 0;
+	}
+
+public: // lookup
+	iterator find(const key_type& key)
+	{
+		auto iter = lower_bound(key);
+		if (end() != iter && !_comp(key, _KeyOf::get(*iter)))
+		{
+			return iter;
+		}
+		return end();
+	}
+	inline const_iterator find(const key_type& key) const { return const_cast<_btree*>(this)->find(key); }
+	inline bool contains(const key_type& key) const { return end() != find(key); }
+	inline size_t count(const key_type& key) const { return contains(key) ? 1 : 0; }
+
+	/// <summary>
+	/// first element not less than key
+	/// </summary>
+	iterator lower_bound(const key_type& key)
+	{
+		if (nullptr == _root)
+		{
+			return end();
+		}
+		auto leaf = _find_leaf(key);
+		return _make_iterator(leaf, _lower_bound_slot(leaf, key));
+	}
+	inline const_iterator lower_bound(const key_type& key) const { return const_cast<_btree*>(this)->lower_bound(key); }
+
+	/// <summary>
+	/// first element greater than key
+	/// </summary>
+	iterator upper_bound(const key_type& key)
+	{
+		if (nullptr == _root)
+		{
+			return end();
+		}
+		auto leaf = _find_leaf(key);
+		return _make_iterator(leaf, _upper_bound_slot(leaf, key));
+	}
+	inline const_iterator upper_bound(const key_type& key) const { return const_cast<_btree*>(this)->upper_bound(key); }
+
+	inline std::pair<iterator, iterator> equal_range(const key_type& key) { return std::make_pair(lower_bound(key), upper_bound(key)); }
+	inline std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const { return std::make_pair(lower_bound(key), upper_bound(key)); }
+
+public: // modifiers
+	inline std::pair<iterator, bool> insert(const value_type& v) { return _emplace_key(_KeyOf::get(v), v); }
+	inline std::pair<iterator, bool> insert(value_type&& v) { return _emplace_key(_KeyOf::get(v), std::move(v)); }
+	template<typename _It>
+	void insert(_It first, _It last)
+	{
+		for (; first != last; ++first)
+		{
+			insert(*first);
+		}
+	}
+	inline void insert(std::initializer_list<value_type> list) { insert(list.begin(), list.end()); }
+
+	template<typename ..._Args>
+	std::pair<iterator, bool> emplace(_Args&&... args)
+	{
+		// the key is only known after construction, build the value on the stack first
+		value_type v(std::forward<_Args>(args)...);
+		return _emplace_key(_KeyOf::get(v), std::move(v));
+	}
+
+	/// <summary>
+	/// returns the element after pos, erasing may move neighbour elements between leaves
+	/// </summary>
+	iterator erase(const_iterator pos)
+	{
+		return _erase_at(pos._leaf, pos._pos);
+	}
+	iterator erase(const_iterator first, const_iterator last)
+	{
+		// last may be moved by rebalancing, count the elements instead of comparing to it
+		auto count = std::distance(first, last);
+		iterator iter(first._leaf, first._pos);
+		for (; 0 < count; --count)
+		{
+			iter = erase(iter);
+		}
+		return iter;
+	}
+	size_t erase(const key_type& key)
+	{
+		auto iter = find(key);
+		if (end() == iter)
+		{
+			return 0;
+		}
+		erase(iter);
+		return 1;
+	}
+
+protected:
+	/// <summary>
+	/// constructs the value from args only when key is absent
+	/// </summary>
+	template<typename ..._Args>
+	std::pair<iterator, bool> _emplace_key(const key_type& key, _Args&&... args)
+	{
+		if (nullptr == _root)
+		{
+			auto leaf = _new_leaf();
+			_root = leaf;
+			_leftmost = leaf;
+			_rightmost = leaf;
+		}
+
+		auto leaf = _find_leaf(key);
+		auto pos = _lower_bound_slot(leaf, key);
+		if (pos < leaf->count && !_comp(key, _KeyOf::get(leaf->slots()[pos])))
+		{
+			return std::make_pair(iterator(leaf, pos), false);
+		}
+
+		if (LeafCapacity > leaf->count)
+		{
+			_leaf_insert(leaf, pos, std::forward<_Args>(args)...);
+			return std::make_pair(iterator(leaf, pos), true);
+		}
+
+		// key and args may refer to a slot that the split moves, build the value first
+		value_type v(std::forward<_Args>(args)...);
+		auto left = leaf;
+		auto right = _split_leaf(left, pos);
+		if (pos >= left->count)
+		{
+			pos -= left->count;
+			leaf = right;
+		}
+		_leaf_insert(leaf, pos, std::move(v));
+		_insert_into_parent(left, _Key(_KeyOf::get(right->slots()[0])), right);
+		return std::make_pair(iterator(leaf, pos), true);
+	}
+
+private:
+
+	inline iterator _make_iterator(_leaf_node* leaf, size_t pos)
+	{
+		if (pos == leaf->count && nullptr != leaf->next)
+		{
+			return iterator(leaf->next, 0);
+		}
+		return iterator(leaf, pos);
+	}
+
+	_leaf_node* _find_leaf(const key_type& key) const
+	{
+		auto node = _root;
+		while (!node->is_leaf)
+		{
+			auto internal = static_cast<_internal_node*>(node);
+			node = internal->children[_upper_bound_key(internal, key)];
+		}
+		return static_cast<_leaf_node*>(node);
+	}
+
+	size_t _upper_bound_key(_internal_node* node, const key_type& key) const
+	{
+		auto keys = node->keys();
+		size_t beg = 0;
+		size_t end = node->count;
+		while (beg < end)
+		{
+			auto mid = (beg + end) / 2;
+			if (_comp(key, keys[mid]))
+			{
+				end = mid;
+			}
+			else
+			{
+				beg = mid + 1;
+			}
+		}
+		return beg;
+	}
+	size_t _lower_bound_slot(_leaf_node* leaf, const key_type& key) const
+	{
+		auto slots = leaf->slots();
+		size_t beg = 0;
+		size_t end = leaf->count;
+		while (beg < end)
+		{
+			auto mid = (beg + end) / 2;
+			if (_comp(_KeyOf::get(slots[mid]), key))
+			{
+				beg = mid + 1;
+			}
+			else
+			{
+				end = mid;
+			}
+		}
+		return beg;
+	}
+	size_t _upper_bound_slot(_leaf_node* leaf, const key_type& key) const
+	{
+		auto slots = leaf->slots();
+		size_t beg = 0;
+		size_t end = leaf->count;
+		while (beg < end)
+		{
+			auto mid = (beg + end) / 2;
+			if (_comp(key, _KeyOf::get(slots[mid])))
+			{
+				end = mid;
+			}
+			else
+			{
+				beg = mid + 1;
+			}
+		}
+		return beg;
+	}
+
+private: // insert
+	template<typename ..._Args>
+	void _leaf_insert(_leaf_node* leaf, size_t pos, _Args&&... args)
+	{
+		_shift_right(leaf->slots(), pos, leaf->count);
+		::new(static_cast<void*>(leaf->slots() + pos)) value_type(std::forward<_Args>(args)...);
+		++leaf->count;
+		++_size;
+	}
+
+	/// <summary>
+	/// moves the upper part of a full leaf into a new right sibling, the parent is not updated yet
+	/// </summary>
+	_leaf_node* _split_leaf(_leaf_node* leaf, size_t pos)
+	{
+		// appending to the rightmost leaf (increasing IDs) keeps the left leaf full instead of half empty
+		size_t mid = (LeafCapacity == pos && nullptr == leaf->next) ? LeafCapacity : LeafCapacity / 2;
+		auto right = _new_leaf();
+		for (size_t i = mid; i < LeafCapacity; ++i)
+		{
+			_relocate(right->slots() + (i - mid), leaf->slots() + i);
+		}
+		right->count = static_cast<uint16_t>(LeafCapacity - mid);
+		leaf->count = static_cast<uint16_t>(mid);
+
+		right->prev = leaf;
+		right->next = leaf->next;
+		if (nullptr != leaf->next)
+		{
+			leaf->next->prev = right;
+		}
+		else
+		{
+			_rightmost = right;
+		}
+		leaf->next = right;
+		return right;
+	}
+
+	void _insert_into_parent(_node* left, const _Key& key, _node* right)
+	{
+		auto parent = left->parent;
+		if (nullptr == parent)
+		{
+			auto root = _new_internal();
+			::new(static_cast<void*>(root->keys())) _Key(key);
+			root->count = 1;
+			_set_child(root, 0, left);
+			_set_child(root, 1, right);
+			_root = root;
+			return;
+		}
+		if (InternalCapacity > parent->count)
+		{
+			_internal_insert(parent, left->pos, key, right);
+			return;
+		}
+
+		// split the full parent, the middle key moves up
+		const size_t mid = InternalCapacity / 2;
+		auto sibling = _new_internal();
+		for (size_t i = mid + 1; i < InternalCapacity; ++i)
+		{
+			_relocate(sibling->keys() + (i - mid - 1), parent->keys() + i);
+		}
+		for (size_t i = mid + 1; i <= InternalCapacity; ++i)
+		{
+			_set_child(sibling, i - mid - 1, parent->children[i]);
+		}
+		sibling->count = static_cast<uint16_t>(InternalCapacity - mid - 1);
+		_Key up_key(std::move(parent->keys()[mid]));
+		parent->keys()[mid].~_Key();
+		parent->count = static_cast<uint16_t>(mid);
+
+		_internal_insert(left->parent, left->pos, key, right);
+		_insert_into_parent(parent, up_key, sibling);
+	}
+
+	void _internal_insert(_internal_node* node, size_t index, const _Key& key, _node* right)
+	{
+		_shift_right(node->keys(), index, node->count);
+		::new(static_cast<void*>(node->keys() + index)) _Key(key);
+		for (auto i = static_cast<size_t>(node->count) + 1; i > index + 1; --i)
+		{
+			_set_child(node, i, node->children[i - 1]);
+		}
+		_set_child(node, index + 1, right);
+		++node->count;
+	}
+
+private: // erase
+	iterator _erase_at(_leaf_node* leaf, size_t pos)
+	{
+		leaf->slots()[pos].~value_type();
+		_shift_left(leaf->slots(), pos, leaf->count);
+		--leaf->count;
+		--_size;
+
+		if (leaf == _root)
+		{
+			if (0 == leaf->count)
+			{
+				clear();
+				return end();
+			}
+			return _make_iterator(leaf, pos);
+		}
+		if (_MinLeafCount <= leaf->count)
+		{
+			return _make_iterator(leaf, pos);
+		}
+
+		auto parent = leaf->parent;
+		auto index = leaf->pos;
+		auto left = 0 < index ? static_cast<_leaf_node*>(parent->children[index - 1]) : nullptr;
+		auto right = parent->count > index ? static_cast<_leaf_node*>(parent->children[index + 1]) : nullptr;
+		if (nullptr != left && _MinLeafCount < left->count)
+		{
+			// borrow the last element of the left sibling
+			_shift_right(leaf->slots(), 0, leaf->count);
+			_relocate(leaf->slots(), left->slots() + left->count - 1);
+			--left->count;
+			++leaf->count;
+			parent->keys()[index - 1] = _KeyOf::get(leaf->slots()[0]);
+			++pos;
+		}
+		else if (nullptr != right && _MinLeafCount < right->count)
+		{
+			// borrow the first element of the right sibling
+			_relocate(leaf->slots() + leaf->count, right->slots());
+			_shift_left(right->slots(), 0, right->count);
+			--right->count;
+			++leaf->count;
+			parent->keys()[index] = _KeyOf::get(right->slots()[0]);
+		}
+		else if (nullptr != left)
+		{
+			pos += left->count;
+			_merge_leaf(left, leaf);
+			leaf = left;
+		}
+		else
+		{
+			_merge_leaf(leaf, right);
+		}
+		return _make_iterator(leaf, pos);
+	}
+
+	void _merge_leaf(_leaf_node* left, _leaf_node* right)
+	{
+		for (size_t i = 0; i < right->count; ++i)
+		{
+			_relocate(left->slots() + left->count + i, right->slots() + i);
+		}
+		left->count = static_cast<uint16_t>(left->count + right->count);
+		left->next = right->next;
+		if (nullptr != right->next)
+		{
+			right->next->prev = left;
+		}
+		else
+		{
+			_rightmost = left;
+		}
+		auto parent = right->parent;
+		auto key_index = static_cast<size_t>(right->pos) - 1;
+		_free_leaf(right);
+		_internal_erase(parent, key_index);
+	}
+
+	/// <summary>
+	/// removes key index and the child right of it
+	/// </summary>
+	void _internal_erase(_internal_node* node, size_t index)
+	{
+		node->keys()[index].~_Key();
+		_shift_left(node->keys(), index, node->count);
+		for (size_t i = index + 1; i < node->count; ++i)
+		{
+			_set_child(node, i, node->children[i + 1]);
+		}
+		--node->count;
+
+		if (node == _root)
+		{
+			if (0 == node->count)
+			{
+				_root = node->children[0];
+				_root->parent = nullptr;
+				_root->pos = 0;
+				_free_internal(node);
+			}
+			return;
+		}
+		if (_MinInternalCount <= node->count)
+		{
+			return;
+		}
+
+		auto parent = node->parent;
+		auto pos = node->pos;
+		auto left = 0 < pos ? static_cast<_internal_node*>(parent->children[pos - 1]) : nullptr;
+		auto right = parent->count > pos ? static_cast<_internal_node*>(parent->children[pos + 1]) : nullptr;
+		if (nullptr != left && _MinInternalCount < left->count)
+		{
+			// rotate the last child of the left sibling through the parent
+			_shift_right(node->keys(), 0, node->count);
+			::new(static_cast<void*>(node->keys())) _Key(std::move(parent->keys()[pos - 1]));
+			parent->keys()[pos - 1] = std::move(left->keys()[left->count - 1]);
+			left->keys()[left->count - 1].~_Key();
+			for (auto i = static_cast<size_t>(node->count) + 1; i > 0; --i)
+			{
+				_set_child(node, i, node->children[i - 1]);
+			}
+			_set_child(node, 0, left->children[left->count]);
+			--left->count;
+			++node->count;
+		}
+		else if (nullptr != right && _MinInternalCount < right->count)
+		{
+			// rotate the first child of the right sibling through the parent
+			::new(static_cast<void*>(node->keys() + node->count)) _Key(std::move(parent->keys()[pos]));
+			parent->keys()[pos] = std::move(right->keys()[0]);
+			right->keys()[0].~_Key();
+			_shift_left(right->keys(), 0, right->count);
+			_set_child(node, static_cast<size_t>(node->count) + 1, right->children[0]);
+			for (size_t i = 0; i < right->count; ++i)
+			{
+				_set_child(right, i, right->children[i + 1]);
+			}
+			--right->count;
+			++node->count;
+		}
+		else if (nullptr != left)
+		{
+			_merge_internal(left, node);
+		}
+		else
+		{
+			_merge_internal(node, right);
+		}
+	}
+
+	void _merge_internal(_internal_node* left, _internal_node* right)
+	{
+		auto parent = left->parent;
+		auto key_index = static_cast<size_t>(left->pos);
+		::new(static_cast<void*>(left->keys() + left->count)) _Key(std::move(parent->keys()[key_index]));
+		for (size_t i = 0; i < right->count; ++i)
+		{
+			_relocate(left->keys() + left->count + 1 + i, right->keys() + i);
+		}
+		for (size_t i = 0; i <= right->count; ++i)
+		{
+			_set_child(left, left->count + 1 + i, right->children[i]);
+		}
+		left->count = static_cast<uint16_t>(left->count + right->count + 1);
+		_free_internal(right);
+		_internal_erase(parent, key_index);
+	}
+
+private: // nodes
+	_leaf_node* _new_leaf()
+	{
+		_leaf_allocator_type leaf_alloc(_alloc);
+		auto leaf = ::new(static_cast<void*>(std::allocator_traits<_leaf_allocator_type>::allocate(leaf_alloc, 1))) _leaf_node;
+		leaf->parent = nullptr;
+		leaf->pos = 0;
+		leaf->count = 0;
+		leaf->is_leaf = true;
+		leaf->prev = nullptr;
+		leaf->next = nullptr;
+		return leaf;
+	}
+	_internal_node* _new_internal()
+	{
+		_internal_allocator_type internal_alloc(_alloc);
+		auto node = ::new(static_cast<void*>(std::allocator_traits<_internal_allocator_type>::allocate(internal_alloc, 1))) _internal_node;
+		node->parent = nullptr;
+		node->pos = 0;
+		node->count = 0;
+		node->is_leaf = false;
+		return node;
+	}
+	void _free_leaf(_leaf_node* leaf)
+	{
+		_leaf_allocator_type leaf_alloc(_alloc);
+		std::allocator_traits<_leaf_allocator_type>::deallocate(leaf_alloc, leaf, 1);
+	}
+	void _free_internal(_internal_node* node)
+	{
+		_internal_allocator_type internal_alloc(_alloc);
+		std::allocator_traits<_internal_allocator_type>::deallocate(internal_alloc, node, 1);
+	}
+
+	void _destroy_subtree(_node* node)
+	{
+		if (node->is_leaf)
+		{
+			auto leaf = static_cast<_leaf_node*>(node);
+			_destroy(leaf->slots(), leaf->count);
+			_free_leaf(leaf);
+			return;
+		}
+		auto internal = static_cast<_internal_node*>(node);
+		for (size_t i = 0; i <= internal->count; ++i)
+		{
+			_destroy_subtree(internal->children[i]);
+		}
+		_destroy(internal->keys(), internal->count);
+		_free_internal(internal);
+	}
+
+	inline static void _set_child(_internal_node* node, size_t index, _node* child)
+	{
+		node->children[index] = child;
+		child->parent = node;
+		child->pos = static_cast<uint16_t>(index);
+	}
+
+	template<typename _T>
+	inline static void _relocate(_T* dst, _T* src)
+	{
+		::new(static_cast<void*>(dst)) _T(std::move(*src));
+		src->~_T();
+	}
+	// [beg, end) -> [beg + 1, end + 1), slot beg is left unconstructed
+	template<typename _T>
+	inline static void _shift_right(_T* p, size_t beg, size_t end)
+	{
+		for (auto i = end; i > beg; --i)
+		{
+			_relocate(p + i, p + i - 1);
+		}
+	}
+	// [beg + 1, end) -> [beg, end - 1), slot beg must be unconstructed
+	template<typename _T>
+	inline static void _shift_left(_T* p, size_t beg, size_t end)
+	{
+		for (auto i = beg; i + 1 < end; ++i)
+		{
+			_relocate(p + i, p + i + 1);
+		}
+	}
+	template<typename _T>
+	inline static void _destroy(_T* p, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			p[i].~_T();
+		}
+	}
+};
+
+struct _btree_set_key_of {
+	template<typename _T>
+	inline static const _T& get(const _T& v) { return v; }
+};
+struct _btree_map_key_of {
+	template<typename _P>
+	inline static const typename _P::first_type& get(const _P& v) { return v.first; }
+};
+
+/// <summary>
+/// ordered set in a pool-backed B+tree, a replacement for set when there are many small elements
+/// </summary>
+template<typename _T, typename _Compare = std::less<_T>, typename _Alloc = allocator<_T>>
+class btree_set : public _btree<_T, _T, _btree_set_key_of, _Compare, _Alloc> {
+	using _base = _btree<_T, _T, _btree_set_key_of, _Compare, _Alloc>;
+
+public:
+	using _base::_base;
+	btree_set() = default;
+	btree_set(std::initializer_list<_T> list)
+	{
+		_base::insert(list);
+	}
+};
+
+/// <summary>
+/// ordered map in a pool-backed B+tree, a replacement for map when there are many small elements
+/// </summary>
+template<typename _K, typename _V, typename _Compare = std::less<_K>, typename _Alloc = allocator<std::pair<const _K, _V>>>
+class btree_map : public _btree<_K, std::pair<const _K, _V>, _btree_map_key_of, _Compare, _Alloc> {
+	using _base = _btree<_K, std::pair<const _K, _V>, _btree_map_key_of, _Compare, _Alloc>;
+
+public:
+	using mapped_type = _V;
+	using typename _base::key_type;
+	using typename _base::value_type;
+	using typename _base::iterator;
+	using typename _base::const_iterator;
+
+	using _base::_base;
+	btree_map() = default;
+	btree_map(std::initializer_list<value_type> list)
+	{
+		_base::insert(list);
+	}
+
+public:
+	template<typename ..._Args>
+	inline std::pair<iterator, bool> try_emplace(const key_type& key, _Args&&... args)
+	{
+		return _base::_emplace_key(key, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<_Args>(args)...));
+	}
+	template<typename ..._Args>
+	inline std::pair<iterator, bool> try_emplace(key_type&& key, _Args&&... args)
+	{
+		return _base::_emplace_key(key, std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::forward_as_tuple(std::forward<_Args>(args)...));
+	}
+
+	template<typename _M>
+	std::pair<iterator, bool> insert_or_assign(const key_type& key, _M&& value)
+	{
+		auto result = try_emplace(key, std::forward<_M>(value));
+		if (!result.second)
+		{
+			result.first->second = std::forward<_M>(value);
+		}
+		return result;
+	}
+
+	inline _V& operator[](const key_type& key) { return try_emplace(key).first->second; }
+	inline _V& operator[](key_type&& key) { return try_emplace(std::move(key)).first->second; }
+
+	_V& at(const key_type& key)
+	{
+		auto iter = _base::find(key);
+		if (_base::end() == iter)
+		{
+			throw std::out_of_range("btree_map::at");
+		}
+		return iter->second;
+	}
+	const _V& at(const key_type& key) const
+	{
+		auto iter = _base::find(key);
+		if (_base::end() == iter)
+		{
+			throw std::out_of_range("btree_map::at");
+		}
+		return iter->second;
+	}
+};
+
+CORE_NAMESPACE_END
+
+#endif
@@ -0,0 +1,338 @@
+
+#ifndef CONCURRENT_QUEUE_H
+#define CONCURRENT_QUEUE_H
+
+#include "core.h"
+#include "noncopyable.h"
+#include "allocator.h"
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <new>
+
+CORE_NAMESPACE_BEG
+
+/// <summary>
+/// indices written by different threads are kept this far apart so they never share a cache line
+/// </summary>
+const size_t CACHE_LINE_SIZE = 64;
+
+inline size_t _queue_capacity_for(size_t capacity)
+{
+	size_t power = 2;
+	while (power < capacity)
+	{
+		power *= 2;
+	}
+	return power;
+}
+
+/// <summary>
+/// bounded lock-free queue for exactly one producer thread and one consumer thread.
+/// capacity is rounded up to a power of 2, the ring is allocated once in the constructor (call it on the thread that owns the pool)
+/// </summary>
+template<typename _T, typename _Alloc = allocator<_T>>
+class spsc_queue final : noncopyable {
+	using _alloc_traits = typename std::allocator_traits<_Alloc>::template rebind_traits<_T>;
+	using _allocator_type = typename std::allocator_traits<_Alloc>::template rebind_alloc<_T>;
+
+	// consumer side
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> _head;
+	size_t _tail_cache;
+	// producer side
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> _tail;
+	size_t _head_cache;
+	// read only after construction
+	alignas(CACHE_LINE_SIZE) _T* _ring;
+	size_t _mask;
+	_allocator_type _alloc;
+
+public:
+	explicit spsc_queue(size_t capacity)
+		: _head(0)
+		, _tail_cache(0)
+		, _tail(0)
+		, _head_cache(0)
+		, _ring(nullptr)
+		, _mask(_queue_capacity_for(capacity) - 1)
+		, _alloc()
+	{
+		_ring = _alloc_traits::allocate(_alloc, _mask + 1);
+	}
+	~spsc_queue()
+	{
+		auto tail = _tail.load(std::memory_order_relaxed);
+		for (auto head = _head.load(std::memory_order_relaxed); head != tail; ++head)
+		{
+			_ring[head & _mask].~_T();
+		}
+		_alloc_traits::deallocate(_alloc, _ring, _mask + 1);
+	}
+
+public: // producer
+	template<typename ..._Args>
+	bool try_emplace(_Args&&... args)
+	{
+		auto tail = _tail.load(std::memory_order_relaxed);
+		if (tail - _head_cache > _mask)
+		{
+			_head_cache = _head.load(std::memory_order_acquire);
+			if (tail - _head_cache > _mask)
+			{
+				return false;
+			}
+		}
+		::new(static_cast<void*>(_ring + (tail & _mask))) _T(std::forward<_Args>(args)...);
+		_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+	inline bool try_push(const _T& value) { return try_emplace(value); }
+	inline bool try_push(_T&& value) { return try_emplace(std::move(value)); }
+
+	/// <summary>
+	/// moves up to count elements from first, the consumer sees all of them with one index update
+	/// </summary>
+	/// <returns>the number of elements pushed</returns>
+	template<typename _It>
+	size_t try_push_batch(_It first, size_t count)
+	{
+		auto tail = _tail.load(std::memory_order_relaxed);
+		auto free_count = _mask + 1 - (tail - _head_cache);
+		if (free_count < count)
+		{
+			_head_cache = _head.load(std::memory_order_acquire);
+			free_count = _mask + 1 - (tail - _head_cache);
+		}
+		if (free_count < count)
+		{
+			count = free_count;
+		}
+		for (size_t i = 0; i < count; ++i, ++first)
+		{
+			::new(static_cast<void*>(_ring + ((tail + i) & _mask))) _T(std::move(*first));
+		}
+		_tail.store(tail + count, std::memory_order_release);
+		return count;
+	}
+
+public: // consumer
+	bool try_pop(_T& value)
+	{
+		auto head = _head.load(std::memory_order_relaxed);
+		if (head == _tail_cache)
+		{
+			_tail_cache = _tail.load(std::memory_order_acquire);
+			if (head == _tail_cache)
+			{
+				return false;
+			}
+		}
+		auto& slot = _ring[head & _mask];
+		value = std::move(slot);
+		slot.~_T();
+		_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// <summary>
+	/// moves up to max_count elements to out, the producer sees the free slots with one index update
+	/// </summary>
+	/// <returns>the number of elements popped</returns>
+	template<typename _OutIt>
+	size_t try_pop_batch(_OutIt out, size_t max_count)
+	{
+		auto head = _head.load(std::memory_order_relaxed);
+		auto count = _tail_cache - head;
+		if (count < max_count)
+		{
+			_tail_cache = _tail.load(std::memory_order_acquire);
+			count = _tail_cache - head;
+		}
+		if (count > max_count)
+		{
+			count = max_count;
+		}
+		for (size_t i = 0; i < count; ++i, ++out)
+		{
+			auto& slot = _ring[(head + i) & _mask];
+			*out = std::move(slot);
+			slot.~_T();
+		}
+		_head.store(head + count, std::memory_order_release);
+		return count;
+	}
+
+public:
+	inline size_t capacity() const { return _mask + 1; }
+	/// <summary>
+	/// exact only when called from the producer or the consumer while the other side is idle
+	/// </summary>
+	inline size_t size_approx() const
+	{
+		return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+	}
+	inline bool empty_approx() const { return 0 == size_approx(); }
+};
+
+/// <summary>
+/// bounded lock-free queue for any number of producers and consumers, each slot carries a sequence number (Vyukov).
+/// capacity is rounded up to a power of 2, the ring is allocated once in the constructor (call it on the thread that owns the pool)
+/// </summary>
+template<typename _T, typename _Alloc = allocator<_T>>
+class mpmc_queue final : noncopyable {
+	struct _cell {
+		std::atomic<size_t> sequence;
+		alignas(_T) unsigned char value_buf[sizeof(_T)];
+
+		inline _T* value() { return reinterpret_cast<_T*>(value_buf); }
+	};
+	using _alloc_traits = typename std::allocator_traits<_Alloc>::template rebind_traits<_cell>;
+	using _allocator_type = typename std::allocator_traits<_Alloc>::template rebind_alloc<_cell>;
+
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> _enqueue_pos;
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> _dequeue_pos;
+	alignas(CACHE_LINE_SIZE) _cell* _ring;
+	size_t _mask;
+	_allocator_type _alloc;
+
+public:
+	explicit mpmc_queue(size_t capacity)
+		: _enqueue_pos(0)
+		, _dequeue_pos(0)
+		, _ring(nullptr)
+		, _mask(_queue_capacity_for(capacity) - 1)
+		, _alloc()
+	{
+		_ring = _alloc_traits::allocate(_alloc, _mask + 1);
+		for (size_t i = 0; i <= _mask; ++i)
+		{
+			::new(static_cast<void*>(&_ring[i].sequence)) std::atomic<size_t>(i);
+		}
+	}
+	~mpmc_queue()
+	{
+		auto tail = _enqueue_pos.load(std::memory_order_relaxed);
+		for (auto head = _dequeue_pos.load(std::memory_order_relaxed); head != tail; ++head)
+		{
+			_ring[head & _mask].value()->~_T();
+		}
+		_alloc_traits::deallocate(_alloc, _ring, _mask + 1);
+	}
+
+public:
+	template<typename ..._Args>
+	bool try_emplace(_Args&&... args)
+	{
+		auto pos = _enqueue_pos.load(std::memory_order_relaxed);
+		_cell* cell;
+		for (;;)
+		{
+			cell = _ring + (pos & _mask);
+			auto diff = static_cast<intptr_t>(cell->sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(pos);
+			if (0 == diff)
+			{
+				if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (0 > diff)
+			{
+				// the consumer of the previous lap has not released this cell, the queue is full
+				return false;
+			}
+			else
+			{
+				pos = _enqueue_pos.load(std::memory_order_relaxed);
+			}
+		}
+		::new(static_cast<void*>(cell->value())) _T(std::forward<_Args>(args)...);
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+	inline bool try_push(const _T& value) { return try_emplace(value); }
+	inline bool try_push(_T&& value) { return try_emplace(std::move(value)); }
+
+	inline bool try_pop(_T& value)
+	{
+		auto p_value = std::addressof(value);
+		return _try_pop_to(p_value);
+	}
+
+	/// <summary>
+	/// slots are claimed one by one, other producers may interleave with the batch
+	/// </summary>
+	/// <returns>the number of elements pushed</returns>
+	template<typename _It>
+	size_t try_push_batch(_It first, size_t count)
+	{
+		size_t pushed_count = 0;
+		for (; pushed_count < count && try_emplace(std::move(*first)); ++pushed_count, ++first)
+		{
+		}
+		return pushed_count;
+	}
+	/// <summary>
+	/// slots are claimed one by one, other consumers may interleave with the batch
+	/// </summary>
+	/// <returns>the number of elements popped</returns>
+	template<typename _OutIt>
+	size_t try_pop_batch(_OutIt out, size_t max_count)
+	{
+		size_t popped_count = 0;
+		for (; popped_count < max_count && _try_pop_to(out); ++popped_count, ++out)
+		{
+		}
+		return popped_count;
+	}
+
+public:
+	inline size_t capacity() const { return _mask + 1; }
+	inline size_t size_approx() const
+	{
+		auto tail = _enqueue_pos.load(std::memory_order_acquire);
+		auto head = _dequeue_pos.load(std::memory_order_acquire);
+		return tail > head ? tail - head : 0;
+	}
+	inline bool empty_approx() const { return 0 == size_approx(); }
+
+private:
+	// claims the next published cell and moves its value straight to *out, _T needs no default constructor
+	template<typename _OutIt>
+	bool _try_pop_to(_OutIt& out)
+	{
+		auto pos = _dequeue_pos.load(std::memory_order_relaxed);
+		_cell* cell;
+		for (;;)
+		{
+			cell = _ring + (pos & _mask);
+			auto diff = static_cast<intptr_t>(cell->sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(pos + 1);
+			if (0 == diff)
+			{
+				if (_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (0 > diff)
+			{
+				// the producer has not published this cell yet, the queue is empty
+				return false;
+			}
+			else
+			{
+				pos = _dequeue_pos.load(std::memory_order_relaxed);
+			}
+		}
+		auto p = cell->value();
+		*out = std::move(*p);
+		p->~_T();
+		cell->sequence.store(pos + _mask + 1, std::memory_order_release);
+		return true;
+	}
+};
+
+CORE_NAMESPACE_END
+
+#endif
@@ -3,7 +3,11 @@
 #define CONTAINERS_H
 
 #include "core.h"
-#include "mem_pool.h"
+#include "allocator.h"
+#include "flat_hash_map.h"
+#include "intrusive_list.h"
+#include "intrusive_hash_set.h"
+#include "hive.h"
 #include <memory>
 #include <limits>
 #include <type_traits>
@@ -20,90 +24,10 @@
 #include <unordered_map>
 #include <string>
 #include <sstream>
+#include <memory_resource>
 
 CORE_NAMESPACE_BEG
 
-template<typename _T>
-class allocator
-{
-public:
-    using value_type = _T;
-    using pointer = _T*;
-    using const_pointer = const _T*;
-    using void_pointer = void*;
-    using const_void_pointer = const void*;
-    using reference = _T&;
-    using const_reference = const _T&;
-    using size_type = size_t;
-    using difference_type = std::ptrdiff_t;
-
-    template<typename _U>
-    struct rebind { using other = allocator<_U>; };
-
-    allocator() = default;
-    ~allocator() = default;
-    allocator(const allocator&) noexcept {};
-    template<typename _U>
-    allocator(const allocator<_U>&) noexcept {};
-    allocator& operator =(const allocator&) = delete;
-
-    inline pointer allocate(size_type count)
-    {
-        return static_cast<pointer>(mem_pool_utils::alloc(sizeof(_T) * count));
-    }
-
-    inline pointer allocate(size_type count, const_void_pointer hit)
-    {
-        hit;
-        return allocate(count);
-    }
-
-    inline void deallocate(pointer p, size_type count)
-    {
-        count;
-        mem_pool_utils::free(p);
-    }
-
-    template<typename _U, typename ...Args>
-    inline void construct(_U* const p, Args&&... args)
-    {
-        ::new(p) _U(std::forward<Args>(args)...);
-    }
-
-    template <typename _U>
-    inline void destroy(_U* const p)
-    {
-        p->~_U();
-    }
-
-    inline pointer address(reference x)
-    {
-        return (pointer)&x;
-    }
-
-    inline const_pointer address(const_reference x)
-    {
-        return (const_pointer)&x;
-    }
-
-    inline size_type max_size() const
-    {
-        return static_cast<size_type>(-1) / sizeof(_T);
-    }
-};
-template <class _T, class _P>
-inline bool operator==(const allocator<_T>&, const allocator<_P>&) noexcept
-{
-    return true;
-}
-template <class _T, class _P>
-inline bool operator!=(const allocator<_T>&, const allocator<_P>&) noexcept
-{
-    return false;
-}
-
-// -------------------------------------
-
 using string = std::basic_string<char, std::char_traits<char>, allocator<char>>;
 using wstring = std::basic_string<wchar_t, std::char_traits<wchar_t>, allocator<wchar_t>>;
 
@@ -159,6 +83,60 @@ using unordered_map = std::unordered_map<_K, _V, std::hash<_K>, std::equal_to<_K
 template<typename _K, typename _V>
 using unordered_multimap = std::unordered_multimap<_K, _V, std::hash<_K>, std::equal_to<_K>, allocator<std::pair<const _K, _V>>>;
 
+// -------------------------------------
+
+/// <summary>
+/// containers bound to a std::pmr::memory_resource at runtime, see mem_pool_resource.h
+/// </summary>
+namespace pmr {
+
+using string = std::pmr::string;
+using wstring = std::pmr::wstring;
+
+template<typename _T>
+using vector = std::pmr::vector<_T>;
+
+template<typename _T>
+using list = std::pmr::list<_T>;
+
+template<typename _T>
+using forward_list = std::pmr::forward_list<_T>;
+
+template<typename _T>
+using deque = std::pmr::deque<_T>;
+
+template<typename _T>
+using stack = std::stack<_T, deque<_T>>;
+
+template<typename _T>
+using queue = std::queue<_T, deque<_T>>;
+
+template<typename _T>
+using set = std::pmr::set<_T>;
+
+template<typename _T>
+using multiset = std::pmr::multiset<_T>;
+
+template<typename _K, typename _V>
+using map = std::pmr::map<_K, _V>;
+
+template<typename _K, typename _V>
+using multimap = std::pmr::multimap<_K, _V>;
+
+template<typename _T>
+using unordered_set = std::pmr::unordered_set<_T>;
+
+template<typename _T>
+using unordered_multiset = std::pmr::unordered_multiset<_T>;
+
+template<typename _K, typename _V>
+using unordered_map = std::pmr::unordered_map<_K, _V>;
+
+template<typename _K, typename _V>
+using unordered_multimap = std::pmr::unordered_multimap<_K, _V>;
+
+}
+
 CORE_NAMESPACE_END
 
 #endif
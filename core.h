@@ -11,17 +11,31 @@
 #define CORE core::
 
 #define ENABLE_REF_SAFE_CHECK 1
+// cheap enough for release builds, needs CELL_GENERATION
+#define ENABLE_TEMP_REF_CHECK 1
 #define ENABLE_MEM_POOL_CLEANUP 1
+// each thread has its own current environment and mem_pool_utils pool
+#define ENABLE_THREAD_LOCAL_ENVIRONMENT 0
+
+#if ENABLE_THREAD_LOCAL_ENVIRONMENT
+#define ENVIRONMENT_STORAGE thread_local
+#else
+#define ENVIRONMENT_STORAGE
+#endif
 
 const int BUG_TAG_MEM_RAW_POOL = 1;
 const int BUG_TAG_MEM_POOL = 2;
+const int BUG_TAG_FRAME_ARENA = 3;
+const int BUG_TAG_ATOM_TABLE = 4;
+const int BUG_TAG_OBJECT_HANDLE_TABLE = 5;
+const int BUG_TAG_ENVIRONMENT = 6;
 
-#if ENABLE_REF_SAFE_CHECK
 const int BUG_TAG_TEMP_REF = 10;
+#if ENABLE_REF_SAFE_CHECK
 const int BUG_TAG_WEAK_REF = 11;
 const int BUG_TAG_SHARED_REF = 12;
-const int BUG_TAG_OBJECT_FACTORY = 13;
 #endif // REF_SAFE_CHECK
+const int BUG_TAG_OBJECT_FACTORY = 13;
 
 const int BUG_TAG_MONITOR_PTR = 21;
 
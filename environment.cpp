@@ -1,6 +1,7 @@
 #include "environment.h"
 #include "bug_reporter.h"
 #include "object_factory.h"
+#include <thread>
 
 CORE_NAMESPACE_BEG
 
@@ -8,6 +9,12 @@ class default_enviroment : public environment {
 	bug_reporter _bug_reporter;
 	object_factory _obj_factory;
 
+public:
+	// the thread that falls back first
+	const std::thread::id owner_thread_id;
+
+	default_enviroment() : owner_thread_id(std::this_thread::get_id()) {}
+
 public:
 	bug_reporter& get_bug_reporter() override { return _bug_reporter; }
 	object_factory& get_object_factory() override { return _obj_factory; }
@@ -20,16 +27,23 @@ public:
 	}
 };
 
-environment* environment::_s_current_env = nullptr;
+ENVIRONMENT_STORAGE environment* environment::_s_current_env = nullptr;
 
-bool environment::_init_default_enviroment()
+environment& environment::_use_default_enviroment()
 {
-	if (nullptr != _s_current_env)
+	auto& env = default_enviroment::get_singleton();
+	if (nullptr == _s_current_env)
 	{
-		return false;
+		_s_current_env = &env;
+#if ENABLE_THREAD_LOCAL_ENVIRONMENT
+		// mem_pool_utils has no pool on this thread and the default factory is not made for it
+		if (std::this_thread::get_id() != env.owner_thread_id)
+		{
+			env.get_bug_reporter().report(BUG_TAG_ENVIRONMENT, "thread without environment falls back to the default environment");
+		}
+#endif // ENABLE_THREAD_LOCAL_ENVIRONMENT
 	}
-	_s_current_env = &default_enviroment::get_singleton();
-	return true;
+	return *_s_current_env;
 }
 
 CORE_NAMESPACE_END
\ No newline at end of file
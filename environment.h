@@ -11,19 +11,23 @@ class bug_reporter;
 class object_factory;
 
 class environment : noncopyable {
-    static bool _init_default_enviroment();
+    static environment& _use_default_enviroment();
 
 public:
+    /// <summary>
+    /// current environment, per thread when ENABLE_THREAD_LOCAL_ENVIRONMENT. a pointer load, no static guard.
+    /// the first thread without one falls back to the process default environment, any other thread doing so is a bug
+    /// </summary>
     inline static environment& get_current_env()
     { 
-        static bool inited = _init_default_enviroment();
-        return *_s_current_env; 
-	}
+        auto p_env = _s_current_env;
+        return nullptr != p_env ? *p_env : _use_default_enviroment();
+    }
     inline static bug_reporter& get_cur_bug_reporter() { return get_current_env().get_bug_reporter(); }
     inline static object_factory& get_cur_object_factory() { return get_current_env().get_object_factory(); }
 
 protected:
-    static environment* _s_current_env;
+    static ENVIRONMENT_STORAGE environment* _s_current_env;
 
 protected:
     environment() { _s_current_env = this; }
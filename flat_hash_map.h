@@ -0,0 +1,740 @@
+
+#ifndef FLAT_HASH_MAP_H
+#define FLAT_HASH_MAP_H
+
+#include "core.h"
+#include "allocator.h"
+#include "sfinae_macros.h"
+#include <memory>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <tuple>
+#include <iterator>
+#include <initializer_list>
+#include <string_view>
+#include <stdexcept>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLAT_HASH_SSE2 1
+#include <emmintrin.h>
+#else
+#define FLAT_HASH_SSE2 0
+#endif // SSE2
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif // _MSC_VER
+
+CORE_NAMESPACE_BEG
+
+/// <summary>
+/// control bytes of the open addressing table: a full slot stores the low 7 bits of its hash,
+/// the other states have the high bit set so a whole group can be tested with one compare
+/// </summary>
+struct _flat_hash_ctrl {
+	typedef int8_t ctrl_type;
+	static const ctrl_type Empty = -128;
+	static const ctrl_type Deleted = -2;
+	static const ctrl_type Sentinel = -1;
+	enum { GroupWidth = 16 };
+
+	inline static bool is_full(ctrl_type c) { return 0 <= c; }
+	inline static bool is_empty_or_deleted(ctrl_type c) { return Sentinel > c; }
+
+	inline static uint32_t lowest_bit_index(uint32_t mask)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return static_cast<uint32_t>(index);
+#else
+		return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif // _MSC_VER
+	}
+};
+
+/// <summary>
+/// GroupWidth control bytes probed at once, every match is returned as a bit mask
+/// </summary>
+class _flat_hash_group {
+	using ctrl_type = _flat_hash_ctrl::ctrl_type;
+
+#if FLAT_HASH_SSE2
+	__m128i _ctrl;
+
+public:
+	inline explicit _flat_hash_group(const ctrl_type* p) : _ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+
+	inline uint32_t match(ctrl_type h2) const
+	{
+		return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), _ctrl)));
+	}
+	inline uint32_t match_empty() const
+	{
+		return match(_flat_hash_ctrl::Empty);
+	}
+	inline uint32_t match_empty_or_deleted() const
+	{
+		// only Empty and Deleted have the high bit set inside a group
+		return static_cast<uint32_t>(_mm_movemask_epi8(_ctrl));
+	}
+#else
+	const ctrl_type* _ctrl;
+
+public:
+	inline explicit _flat_hash_group(const ctrl_type* p) : _ctrl(p) {}
+
+	inline uint32_t match(ctrl_type h2) const
+	{
+		uint32_t mask = 0;
+		for (uint32_t i = 0; i < _flat_hash_ctrl::GroupWidth; ++i)
+		{
+			mask |= static_cast<uint32_t>(h2 == _ctrl[i]) << i;
+		}
+		return mask;
+	}
+	inline uint32_t match_empty() const
+	{
+		return match(_flat_hash_ctrl::Empty);
+	}
+	inline uint32_t match_empty_or_deleted() const
+	{
+		uint32_t mask = 0;
+		for (uint32_t i = 0; i < _flat_hash_ctrl::GroupWidth; ++i)
+		{
+			mask |= static_cast<uint32_t>(_flat_hash_ctrl::is_empty_or_deleted(_ctrl[i])) << i;
+		}
+		return mask;
+	}
+#endif // FLAT_HASH_SSE2
+};
+
+template<typename _T, typename = void>
+struct _is_transparent : std::false_type {};
+template<typename _T>
+struct _is_transparent<_T, std::void_t<typename _T::is_transparent>> : std::true_type {};
+
+/// <summary>
+/// transparent hash for strings, allows looking up a string keyed table with a const char* or string_view
+/// without building a temporary string
+/// </summary>
+struct string_hash {
+	using is_transparent = void;
+	inline size_t operator()(std::string_view s) const { return std::hash<std::string_view>()(s); }
+};
+struct string_equal_to {
+	using is_transparent = void;
+	inline bool operator()(std::string_view lhs, std::string_view rhs) const { return lhs == rhs; }
+};
+
+/// <summary>
+/// SwissTable-style open addressing table shared by flat_hash_map and flat_hash_set.
+/// slots are stored flat in one array, probing walks groups of control bytes instead of chasing nodes.
+/// pointers and iterators are invalidated by rehashing
+/// </summary>
+template<typename _Key, typename _Value, typename _KeyOf, typename _Hash, typename _Eq, typename _Alloc>
+class _flat_hash_table {
+	using _ctrl = _flat_hash_ctrl;
+	using _ctrl_type = _flat_hash_ctrl::ctrl_type;
+	using _alloc_traits = std::allocator_traits<_Alloc>;
+	using _slot_allocator_type = typename _alloc_traits::template rebind_alloc<_Value>;
+	using _ctrl_allocator_type = typename _alloc_traits::template rebind_alloc<_ctrl_type>;
+
+	static const size_t _npos = static_cast<size_t>(-1);
+
+public:
+	using key_type = _Key;
+	using value_type = _Value;
+	using size_type = size_t;
+	using difference_type = std::ptrdiff_t;
+	using hasher = _Hash;
+	using key_equal = _Eq;
+	using allocator_type = _Alloc;
+	using reference = value_type&;
+	using const_reference = const value_type&;
+
+	template<typename _V>
+	class _iterator {
+		friend class _flat_hash_table;
+		template<typename _U>
+		friend class _iterator;
+
+		const _ctrl_type* _p_ctrl;
+		_V* _p_slot;
+
+		inline _iterator(const _ctrl_type* p_ctrl, _V* p_slot) : _p_ctrl(p_ctrl), _p_slot(p_slot) { _skip_free(); }
+		inline void _skip_free()
+		{
+			if (nullptr == _p_ctrl)
+			{
+				return;
+			}
+			while (_ctrl::is_empty_or_deleted(*_p_ctrl))
+			{
+				++_p_ctrl;
+				++_p_slot;
+			}
+		}
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = typename std::remove_const<_V>::type;
+		using difference_type = std::ptrdiff_t;
+		using pointer = _V*;
+		using reference = _V&;
+
+		inline _iterator() : _p_ctrl(nullptr), _p_slot(nullptr) {}
+		template<typename _U, enable_if_int<std::is_convertible<_U*, _V*>::value> = 0>
+		inline _iterator(const _iterator<_U>& other) : _p_ctrl(other._p_ctrl), _p_slot(other._p_slot) {}
+
+		inline reference operator*() const { return *_p_slot; }
+		inline pointer operator->() const { return _p_slot; }
+		inline _iterator& operator++()
+		{
+			++_p_ctrl;
+			++_p_slot;
+			_skip_free();
+			return *this;
+		}
+		inline _iterator operator++(int)
+		{
+			auto tmp = *this;
+			++*this;
+			return tmp;
+		}
+		inline bool operator==(const _iterator& rhs) const { return _p_slot == rhs._p_slot; }
+		inline bool operator!=(const _iterator& rhs) const { return _p_slot != rhs._p_slot; }
+	};
+	using iterator = _iterator<value_type>;
+	using const_iterator = _iterator<const value_type>;
+
+private:
+	_ctrl_type* _ctrls;
+	value_type* _slots;
+	size_t _capacity;
+	size_t _size;
+	size_t _growth_left;
+	_Hash _hash;
+	_Eq _eq;
+	_Alloc _alloc;
+
+public:
+	inline explicit _flat_hash_table(size_t bucket_count = 0, const _Hash& hash = _Hash(), const _Eq& eq = _Eq(), const _Alloc& alloc = _Alloc())
+		: _ctrls(nullptr)
+		, _slots(nullptr)
+		, _capacity(0)
+		, _size(0)
+		, _growth_left(0)
+		, _hash(hash)
+		, _eq(eq)
+		, _alloc(alloc)
+	{
+		if (0 < bucket_count)
+		{
+			reserve(bucket_count);
+		}
+	}
+	_flat_hash_table(const _flat_hash_table& other)
+		: _flat_hash_table(0, other._hash, other._eq, other._alloc)
+	{
+		reserve(other._size);
+		for (auto& v : other)
+		{
+			_insert_unique_unchecked(_hash_of(_KeyOf::get(v)), v);
+		}
+	}
+	_flat_hash_table(_flat_hash_table&& other) noexcept
+		: _ctrls(other._ctrls)
+		, _slots(other._slots)
+		, _capacity(other._capacity)
+		, _size(other._size)
+		, _growth_left(other._growth_left)
+		, _hash(std::move(other._hash))
+		, _eq(std::move(other._eq))
+		, _alloc(std::move(other._alloc))
+	{
+		other._ctrls = nullptr;
+		other._slots = nullptr;
+		other._capacity = 0;
+		other._size = 0;
+		other._growth_left = 0;
+	}
+	~_flat_hash_table()
+	{
+		_destroy_slots();
+		_dealloc(_ctrls, _slots, _capacity);
+	}
+
+	_flat_hash_table& operator=(const _flat_hash_table& other)
+	{
+		if (this != &other)
+		{
+			_flat_hash_table(other).swap(*this);
+		}
+		return *this;
+	}
+	_flat_hash_table& operator=(_flat_hash_table&& other) noexcept
+	{
+		if (this != &other)
+		{
+			_flat_hash_table(std::move(other)).swap(*this);
+		}
+		return *this;
+	}
+
+	void swap(_flat_hash_table& other) noexcept
+	{
+		std::swap(_ctrls, other._ctrls);
+		std::swap(_slots, other._slots);
+		std::swap(_capacity, other._capacity);
+		std::swap(_size, other._size);
+		std::swap(_growth_left, other._growth_left);
+		std::swap(_hash, other._hash);
+		std::swap(_eq, other._eq);
+		// allocators are not swapped, _Alloc must compare equal across tables like core::allocator does
+	}
+
+public:
+	inline iterator begin() { return 0 == _capacity ? end() : iterator(_ctrls, _slots); }
+	inline const_iterator begin() const { return 0 == _capacity ? end() : const_iterator(_ctrls, _slots); }
+	inline const_iterator cbegin() const { return begin(); }
+	inline iterator end() { return iterator(nullptr, _slots + _capacity); }
+	inline const_iterator end() const { return const_iterator(nullptr, _slots + _capacity); }
+	inline const_iterator cend() const { return end(); }
+
+	inline size_t size() const { return _size; }
+	inline bool empty() const { return 0 == _size; }
+	inline size_t capacity() const { return _capacity; }
+	inline float load_factor() const { return 0 == _capacity ? 0.0f : static_cast<float>(_size) / _capacity; }
+	inline hasher hash_function() const { return _hash; }
+	inline key_equal key_eq() const { return _eq; }
+	inline allocator_type get_allocator() const { return _alloc; }
+
+	void clear()
+	{
+		if (0 == _capacity)
+		{
+			return;
+		}
+		_destroy_slots();
+		_reset_ctrls();
+	}
+
+	/// <summary>
+	/// make room for count elements without rehashing
+	/// </summary>
+	void reserve(size_t count)
+	{
+		auto new_capacity = _capacity_for(count);
+		if (new_capacity > _capacity)
+		{
+			_rehash(new_capacity);
+		}
+	}
+	void rehash(size_t count)
+	{
+		auto new_capacity = _capacity_for(count > _size ? count : _size);
+		if (new_capacity != _capacity)
+		{
+			_rehash(new_capacity);
+		}
+	}
+
+public: // lookup
+	inline iterator find(const key_type& key) { return _iterator_at(_find_index(key)); }
+	inline const_iterator find(const key_type& key) const { return _iterator_at(_find_index(key)); }
+	inline bool contains(const key_type& key) const { return _npos != _find_index(key); }
+	inline size_t count(const key_type& key) const { return contains(key) ? 1 : 0; }
+
+	template<typename _Q, typename _H = _Hash, enable_if_int<_is_transparent<_H>::value && _is_transparent<_Eq>::value> = 0>
+	inline iterator find(const _Q& key) { return _iterator_at(_find_index(key)); }
+	template<typename _Q, typename _H = _Hash, enable_if_int<_is_transparent<_H>::value && _is_transparent<_Eq>::value> = 0>
+	inline const_iterator find(const _Q& key) const { return _iterator_at(_find_index(key)); }
+	template<typename _Q, typename _H = _Hash, enable_if_int<_is_transparent<_H>::value && _is_transparent<_Eq>::value> = 0>
+	inline bool contains(const _Q& key) const { return _npos != _find_index(key); }
+	template<typename _Q, typename _H = _Hash, enable_if_int<_is_transparent<_H>::value && _is_transparent<_Eq>::value> = 0>
+	inline size_t count(const _Q& key) const { return contains(key) ? 1 : 0; }
+
+public: // modifiers
+	inline std::pair<iterator, bool> insert(const value_type& v) { return _emplace_key(_KeyOf::get(v), v); }
+	inline std::pair<iterator, bool> insert(value_type&& v) { return _emplace_key(_KeyOf::get(v), std::move(v)); }
+	template<typename _It>
+	void insert(_It first, _It last)
+	{
+		for (; first != last; ++first)
+		{
+			insert(*first);
+		}
+	}
+	inline void insert(std::initializer_list<value_type> list) { insert(list.begin(), list.end()); }
+
+	template<typename ..._Args>
+	std::pair<iterator, bool> emplace(_Args&&... args)
+	{
+		// the key is only known after construction, build the value on the stack first
+		value_type v(std::forward<_Args>(args)...);
+		return _emplace_key(_KeyOf::get(v), std::move(v));
+	}
+
+	iterator erase(const_iterator pos)
+	{
+		auto index = static_cast<size_t>(pos._p_slot - _slots);
+		_erase_at(index);
+		return iterator(_ctrls + index, _slots + index);
+	}
+	iterator erase(const_iterator first, const_iterator last)
+	{
+		while (first != last)
+		{
+			first = erase(first);
+		}
+		return _iterator_at(static_cast<size_t>(last._p_slot - _slots));
+	}
+	inline size_t erase(const key_type& key) { return _erase_key(key); }
+	template<typename _Q, typename _H = _Hash, enable_if_int<_is_transparent<_H>::value && _is_transparent<_Eq>::value> = 0>
+	inline size_t erase(const _Q& key) { return _erase_key(key); }
+
+protected:
+	/// <summary>
+	/// constructs the value from args only when key is absent
+	/// </summary>
+	template<typename _K, typename ..._Args>
+	std::pair<iterator, bool> _emplace_key(const _K& key, _Args&&... args)
+	{
+		auto hash = _hash_of(key);
+		auto index = _find_index(key, hash);
+		if (_npos != index)
+		{
+			return std::make_pair(_iterator_at(index), false);
+		}
+		if (0 == _growth_left)
+		{
+			// key and args may refer to a slot that the rehash moves, build the value first
+			value_type v(std::forward<_Args>(args)...);
+			_grow();
+			index = _insert_unique_unchecked(hash, std::move(v));
+			return std::make_pair(_iterator_at(index), true);
+		}
+		index = _insert_unique_unchecked(hash, std::forward<_Args>(args)...);
+		return std::make_pair(_iterator_at(index), true);
+	}
+
+	template<typename _K>
+	inline size_t _find_index(const _K& key) const
+	{
+		return _find_index(key, _hash_of(key));
+	}
+
+	inline iterator _iterator_at(size_t index) { return _npos == index ? end() : iterator(_ctrls + index, _slots + index); }
+	inline const_iterator _iterator_at(size_t index) const { return _npos == index ? end() : const_iterator(_ctrls + index, _slots + index); }
+
+private:
+	template<typename _K>
+	inline size_t _hash_of(const _K& key) const
+	{
+		// std::hash is often the identity, mix it so h1 and h2 both depend on every input bit
+		auto h = static_cast<uint64_t>(_hash(key)) * 0x9E3779B97F4A7C15ull;
+		return static_cast<size_t>(h ^ (h >> 32));
+	}
+	inline static size_t _h1(size_t hash) { return hash >> 7; }
+	inline static _ctrl_type _h2(size_t hash) { return static_cast<_ctrl_type>(hash & 0x7F); }
+
+	template<typename _K>
+	size_t _find_index(const _K& key, size_t hash) const
+	{
+		if (0 == _capacity)
+		{
+			return _npos;
+		}
+		const auto group_mask = _capacity / _ctrl::GroupWidth - 1;
+		const auto h2 = _h2(hash);
+		auto group_index = _h1(hash) & group_mask;
+		for (size_t step = 1; ; ++step)
+		{
+			const auto group_beg = group_index * _ctrl::GroupWidth;
+			_flat_hash_group group(_ctrls + group_beg);
+			for (auto mask = group.match(h2); 0 != mask; mask &= mask - 1)
+			{
+				auto index = group_beg + _ctrl::lowest_bit_index(mask);
+				if (_eq(_KeyOf::get(_slots[index]), key))
+				{
+					return index;
+				}
+			}
+			if (0 != group.match_empty())
+			{
+				return _npos;
+			}
+			group_index = (group_index + step) & group_mask;
+		}
+	}
+
+	size_t _find_free_index(size_t hash) const
+	{
+		const auto group_mask = _capacity / _ctrl::GroupWidth - 1;
+		auto group_index = _h1(hash) & group_mask;
+		for (size_t step = 1; ; ++step)
+		{
+			const auto group_beg = group_index * _ctrl::GroupWidth;
+			auto mask = _flat_hash_group(_ctrls + group_beg).match_empty_or_deleted();
+			if (0 != mask)
+			{
+				return group_beg + _ctrl::lowest_bit_index(mask);
+			}
+			group_index = (group_index + step) & group_mask;
+		}
+	}
+
+	template<typename ..._Args>
+	size_t _insert_unique_unchecked(size_t hash, _Args&&... args)
+	{
+		auto index = _find_free_index(hash);
+		_slot_allocator_type slot_alloc(_alloc);
+		std::allocator_traits<_slot_allocator_type>::construct(slot_alloc, _slots + index, std::forward<_Args>(args)...);
+		if (_ctrl::Empty == _ctrls[index])
+		{
+			--_growth_left;
+		}
+		_ctrls[index] = _h2(hash);
+		++_size;
+		return index;
+	}
+
+	template<typename _K>
+	size_t _erase_key(const _K& key)
+	{
+		auto index = _find_index(key);
+		if (_npos == index)
+		{
+			return 0;
+		}
+		_erase_at(index);
+		return 1;
+	}
+
+	void _erase_at(size_t index)
+	{
+		_slot_allocator_type slot_alloc(_alloc);
+		std::allocator_traits<_slot_allocator_type>::destroy(slot_alloc, _slots + index);
+		--_size;
+
+		// a group that still has an empty slot never made a probe go past it, so the slot can become empty again;
+		// otherwise leave a tombstone to keep later probe chains intact
+		auto group_beg = index / _ctrl::GroupWidth * _ctrl::GroupWidth;
+		if (0 != _flat_hash_group(_ctrls + group_beg).match_empty())
+		{
+			_ctrls[index] = _ctrl::Empty;
+			++_growth_left;
+		}
+		else
+		{
+			_ctrls[index] = _ctrl::Deleted;
+		}
+	}
+
+	inline static size_t _max_size_for(size_t capacity)
+	{
+		// max load factor 7/8
+		return capacity - capacity / 8;
+	}
+	inline static size_t _capacity_for(size_t count)
+	{
+		if (0 == count)
+		{
+			return 0;
+		}
+		size_t capacity = _ctrl::GroupWidth;
+		while (_max_size_for(capacity) < count)
+		{
+			capacity *= 2;
+		}
+		return capacity;
+	}
+
+	void _grow()
+	{
+		if (0 == _capacity)
+		{
+			_rehash(_ctrl::GroupWidth);
+		}
+		else if (_size <= _max_size_for(_capacity) / 2)
+		{
+			// mostly tombstones, clean them up in a table of the same size
+			_rehash(_capacity);
+		}
+		else
+		{
+			_rehash(_capacity * 2);
+		}
+	}
+
+	void _rehash(size_t new_capacity)
+	{
+		auto old_ctrls = _ctrls;
+		auto old_slots = _slots;
+		auto old_capacity = _capacity;
+
+		_alloc_table(new_capacity);
+		_size = 0;
+		_reset_ctrls();
+
+		_slot_allocator_type slot_alloc(_alloc);
+		for (size_t i = 0; i < old_capacity; ++i)
+		{
+			if (_ctrl::is_full(old_ctrls[i]))
+			{
+				auto& v = old_slots[i];
+				_insert_unique_unchecked(_hash_of(_KeyOf::get(v)), std::move(v));
+				std::allocator_traits<_slot_allocator_type>::destroy(slot_alloc, &v);
+			}
+		}
+		_dealloc(old_ctrls, old_slots, old_capacity);
+	}
+
+	void _alloc_table(size_t capacity)
+	{
+		_ctrl_allocator_type ctrl_alloc(_alloc);
+		_slot_allocator_type slot_alloc(_alloc);
+		_ctrls = std::allocator_traits<_ctrl_allocator_type>::allocate(ctrl_alloc, capacity + 1);
+		_slots = std::allocator_traits<_slot_allocator_type>::allocate(slot_alloc, capacity);
+		_capacity = capacity;
+	}
+
+	void _dealloc(_ctrl_type* ctrls, value_type* slots, size_t capacity)
+	{
+		if (0 == capacity)
+		{
+			return;
+		}
+		_ctrl_allocator_type ctrl_alloc(_alloc);
+		_slot_allocator_type slot_alloc(_alloc);
+		std::allocator_traits<_ctrl_allocator_type>::deallocate(ctrl_alloc, ctrls, capacity + 1);
+		std::allocator_traits<_slot_allocator_type>::deallocate(slot_alloc, slots, capacity);
+	}
+
+	void _reset_ctrls()
+	{
+		memset(_ctrls, static_cast<uint8_t>(_ctrl::Empty), _capacity);
+		_ctrls[_capacity] = _ctrl::Sentinel;
+		_size = 0;
+		_growth_left = _max_size_for(_capacity);
+	}
+
+	void _destroy_slots()
+	{
+		if (0 == _size)
+		{
+			return;
+		}
+		_slot_allocator_type slot_alloc(_alloc);
+		for (size_t i = 0; i < _capacity; ++i)
+		{
+			if (_ctrl::is_full(_ctrls[i]))
+			{
+				std::allocator_traits<_slot_allocator_type>::destroy(slot_alloc, _slots + i);
+			}
+		}
+	}
+};
+
+struct _flat_hash_set_key_of {
+	template<typename _T>
+	inline static const _T& get(const _T& v) { return v; }
+};
+struct _flat_hash_map_key_of {
+	template<typename _P>
+	inline static const typename _P::first_type& get(const _P& v) { return v.first; }
+};
+
+/// <summary>
+/// open addressing hash set, elements live in one flat array allocated from mem_pool.
+/// heterogeneous lookup is enabled when both _Hash and _Eq define is_transparent
+/// </summary>
+template<typename _T, typename _Hash = std::hash<_T>, typename _Eq = std::equal_to<_T>, typename _Alloc = allocator<_T>>
+class flat_hash_set : public _flat_hash_table<_T, _T, _flat_hash_set_key_of, _Hash, _Eq, _Alloc> {
+	using _base = _flat_hash_table<_T, _T, _flat_hash_set_key_of, _Hash, _Eq, _Alloc>;
+
+public:
+	using _base::_base;
+	flat_hash_set() = default;
+	flat_hash_set(std::initializer_list<_T> list)
+		: _base(list.size())
+	{
+		_base::insert(list);
+	}
+};
+
+/// <summary>
+/// open addressing hash map, key-value pairs live in one flat array allocated from mem_pool.
+/// heterogeneous lookup is enabled when both _Hash and _Eq define is_transparent
+/// </summary>
+template<typename _K, typename _V, typename _Hash = std::hash<_K>, typename _Eq = std::equal_to<_K>, typename _Alloc = allocator<std::pair<const _K, _V>>>
+class flat_hash_map : public _flat_hash_table<_K, std::pair<const _K, _V>, _flat_hash_map_key_of, _Hash, _Eq, _Alloc> {
+	using _base = _flat_hash_table<_K, std::pair<const _K, _V>, _flat_hash_map_key_of, _Hash, _Eq, _Alloc>;
+
+public:
+	using mapped_type = _V;
+	using typename _base::key_type;
+	using typename _base::value_type;
+	using typename _base::iterator;
+	using typename _base::const_iterator;
+
+	using _base::_base;
+	flat_hash_map() = default;
+	flat_hash_map(std::initializer_list<value_type> list)
+		: _base(list.size())
+	{
+		_base::insert(list);
+	}
+
+public:
+	template<typename ..._Args>
+	inline std::pair<iterator, bool> try_emplace(const key_type& key, _Args&&... args)
+	{
+		return _base::_emplace_key(key, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<_Args>(args)...));
+	}
+	template<typename ..._Args>
+	inline std::pair<iterator, bool> try_emplace(key_type&& key, _Args&&... args)
+	{
+		return _base::_emplace_key(key, std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::forward_as_tuple(std::forward<_Args>(args)...));
+	}
+
+	template<typename _M>
+	std::pair<iterator, bool> insert_or_assign(const key_type& key, _M&& value)
+	{
+		auto result = try_emplace(key, std::forward<_M>(value));
+		if (!result.second)
+		{
+			result.first->second = std::forward<_M>(value);
+		}
+		return result;
+	}
+
+	inline _V& operator[](const key_type& key) { return try_emplace(key).first->second; }
+	inline _V& operator[](key_type&& key) { return try_emplace(std::move(key)).first->second; }
+
+	_V& at(const key_type& key)
+	{
+		auto iter = _base::find(key);
+		if (_base::end() == iter)
+		{
+			throw std::out_of_range("flat_hash_map::at");
+		}
+		return iter->second;
+	}
+	const _V& at(const key_type& key) const
+	{
+		auto iter = _base::find(key);
+		if (_base::end() == iter)
+		{
+			throw std::out_of_range("flat_hash_map::at");
+		}
+		return iter->second;
+	}
+};
+
+CORE_NAMESPACE_END
+
+#endif
@@ -0,0 +1,124 @@
+
+#include "frame_arena.h"
+#include "environment.h"
+#include "bug_reporter.h"
+
+CORE_NAMESPACE_BEG
+
+frame_arena::frame_arena(size_t block_size)
+	: _blocks()
+	, _block_size(block_size)
+	, _next_block_index(0)
+	, _cur_block_beg(0)
+	, _cur(0)
+	, _end(0)
+	, _used_size_in_prev_blocks(0)
+	, _high_water_size(0)
+	, _scope_depth(0)
+{
+
+}
+
+frame_arena::~frame_arena()
+{
+	for (auto& block : _blocks)
+	{
+		::operator delete(block.mem);
+	}
+	_blocks.clear();
+	reset();
+}
+
+void frame_arena::reset()
+{
+	if (0 != _scope_depth)
+	{
+		_report("frame_arena reset while scoped_arena is alive");
+	}
+	_high_water_size = get_high_water_size();
+	_next_block_index = 0;
+	_cur_block_beg = 0;
+	_cur = 0;
+	_end = 0;
+	_used_size_in_prev_blocks = 0;
+}
+
+void frame_arena::rewind(const marker& m)
+{
+	if (m.next_block_index > _next_block_index || (m.next_block_index == _next_block_index && m.cur > _cur))
+	{
+		_report("frame_arena rewind to a marker that is not behind the current position");
+		return;
+	}
+	_high_water_size = get_high_water_size();
+	if (0 == m.next_block_index)
+	{
+		_next_block_index = 0;
+		_cur_block_beg = 0;
+		_cur = 0;
+		_end = 0;
+	}
+	else
+	{
+		_use_block(m.next_block_index - 1);
+		_cur = m.cur;
+	}
+	_used_size_in_prev_blocks = m.used_size_in_prev_blocks;
+}
+
+size_t frame_arena::get_reserved_size() const
+{
+	size_t reserved_size = 0;
+	for (auto& block : _blocks)
+	{
+		reserved_size += block.size;
+	}
+	return reserved_size;
+}
+
+void* frame_arena::_alloc_from_next_block(size_t size, size_t align)
+{
+	// the rest of the current block is left unused until reset
+	_used_size_in_prev_blocks += static_cast<size_t>(_cur - _cur_block_beg);
+
+	// 1. reuse a block kept from previous frames
+	while (_blocks.size() > _next_block_index)
+	{
+		auto& block = _blocks[_next_block_index];
+		auto beg = (intptr_t)block.mem;
+		if (static_cast<size_t>(_align_up(beg, align) - beg) + size <= block.size)
+		{
+			break;
+		}
+		++_next_block_index;
+	}
+
+	// 2. grow, a request bigger than the block size gets a block of its own
+	if (_blocks.size() == _next_block_index)
+	{
+		auto block_size = _block_size > size + align ? _block_size : size + align;
+		_blocks.push_back({ ::operator new(block_size), block_size });
+	}
+
+	// 3.
+	_use_block(_next_block_index);
+	auto p = _align_up(_cur, align);
+	_cur = p + static_cast<intptr_t>(size);
+	return (void*)p;
+}
+
+void frame_arena::_report(const char* message)
+{
+	environment::get_cur_bug_reporter().report(BUG_TAG_FRAME_ARENA, message);
+}
+
+void frame_arena::_use_block(size_t block_index)
+{
+	auto& block = _blocks[block_index];
+	_cur_block_beg = (intptr_t)block.mem;
+	_cur = _cur_block_beg;
+	_end = _cur_block_beg + static_cast<intptr_t>(block.size);
+	_next_block_index = block_index + 1;
+}
+
+CORE_NAMESPACE_END
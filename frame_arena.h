@@ -0,0 +1,196 @@
+
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include "core.h"
+#include "noncopyable.h"
+#include "dis_new.h"
+#include <vector>
+#include <type_traits>
+#include <utility>
+#include <new>
+
+CORE_NAMESPACE_BEG
+
+/// <summary>
+/// bump allocator for scratch memory that lives until reset(), usually the end of the frame.
+/// blocks are kept across reset(), so after the first busy frame the arena no longer allocates
+/// </summary>
+class frame_arena final : noncopyable {
+	friend class scoped_arena;
+
+	struct _block {
+		void* mem;
+		size_t size;
+	};
+	using _block_array_type = std::vector<_block>;
+
+	_block_array_type _blocks;
+	size_t _block_size;
+	size_t _next_block_index;
+	intptr_t _cur_block_beg;
+	intptr_t _cur;
+	intptr_t _end;
+	size_t _used_size_in_prev_blocks;
+	size_t _high_water_size;
+	size_t _scope_depth;
+
+public:
+	static const size_t DefaultAlign = alignof(std::max_align_t);
+
+	explicit frame_arena(size_t block_size);
+	~frame_arena();
+
+public:
+	/// <summary>
+	/// align must be a power of 2
+	/// </summary>
+	inline void* alloc(size_t size, size_t align = DefaultAlign)
+	{
+		auto p = _align_up(_cur, align);
+		if (0 == _cur || _end < p || static_cast<size_t>(_end - p) < size)
+		{
+			return _alloc_from_next_block(size, align);
+		}
+		_cur = p + static_cast<intptr_t>(size);
+		return (void*)p;
+	}
+
+	/// <summary>
+	/// destructors are never called, memory is simply dropped by reset()
+	/// </summary>
+	template<typename _T, typename ..._Args>
+	inline _T* make(_Args&&... args)
+	{
+		static_assert(std::is_trivially_destructible<_T>::value, "_T must be trivially destructible");
+		return ::new(alloc(sizeof(_T), alignof(_T))) _T(std::forward<_Args>(args)...);
+	}
+
+	/// <summary>
+	/// elements are value-initialized, destructors are never called
+	/// </summary>
+	template<typename _T>
+	inline _T* make_array(size_t count)
+	{
+		static_assert(std::is_trivially_destructible<_T>::value, "_T must be trivially destructible");
+		if (0 == count)
+		{
+			return nullptr;
+		}
+		auto p = static_cast<_T*>(alloc(sizeof(_T) * count, alignof(_T)));
+		for (size_t i = 0; i < count; ++i)
+		{
+			::new(p + i) _T();
+		}
+		return p;
+	}
+
+	/// <summary>
+	/// drop everything allocated since the last reset, blocks are kept for reuse
+	/// </summary>
+	void reset();
+
+public:
+	struct marker {
+		size_t next_block_index;
+		intptr_t cur;
+		size_t used_size_in_prev_blocks;
+	};
+
+	inline marker get_marker() const
+	{
+		return { _next_block_index, _cur, _used_size_in_prev_blocks };
+	}
+
+	/// <summary>
+	/// drop everything allocated after the marker was taken, markers must be rewound LIFO
+	/// </summary>
+	void rewind(const marker& m);
+
+public:
+	inline size_t get_used_size() const
+	{
+		return _used_size_in_prev_blocks + static_cast<size_t>(_cur - _cur_block_beg);
+	}
+	inline size_t get_high_water_size() const
+	{
+		auto used_size = get_used_size();
+		return _high_water_size > used_size ? _high_water_size : used_size;
+	}
+	size_t get_reserved_size() const;
+
+private:
+	inline static intptr_t _align_up(intptr_t p, size_t align)
+	{
+		return (p + static_cast<intptr_t>(align - 1)) & ~static_cast<intptr_t>(align - 1);
+	}
+	void* _alloc_from_next_block(size_t size, size_t align);
+	void _use_block(size_t block_index);
+	static void _report(const char* message);
+};
+
+/// <summary>
+/// scratch allocations on a frame_arena that are dropped in O(1) when the scope ends,
+/// scopes on one arena must be nested and only the innermost one may allocate
+/// </summary>
+class scoped_arena final : noncopyable, dis_new {
+	frame_arena& _arena;
+	frame_arena::marker _marker;
+	size_t _used_size_at_beg;
+	size_t _depth;
+
+public:
+	inline explicit scoped_arena(frame_arena& arena)
+		: _arena(arena)
+		, _marker(arena.get_marker())
+		, _used_size_at_beg(arena.get_used_size())
+		, _depth(++arena._scope_depth)
+	{
+	}
+	~scoped_arena()
+	{
+		if (_depth != _arena._scope_depth)
+		{
+			frame_arena::_report("scoped_arena is not destroyed in LIFO order");
+		}
+		--_arena._scope_depth;
+		_arena.rewind(_marker);
+	}
+
+public:
+	inline void* alloc(size_t size, size_t align = frame_arena::DefaultAlign)
+	{
+		_check_innermost();
+		return _arena.alloc(size, align);
+	}
+	template<typename _T, typename ..._Args>
+	inline _T* make(_Args&&... args)
+	{
+		_check_innermost();
+		return _arena.make<_T>(std::forward<_Args>(args)...);
+	}
+	template<typename _T>
+	inline _T* make_array(size_t count)
+	{
+		_check_innermost();
+		return _arena.make_array<_T>(count);
+	}
+
+	inline size_t get_used_size() const
+	{
+		return _arena.get_used_size() - _used_size_at_beg;
+	}
+
+private:
+	inline void _check_innermost() const
+	{
+		if (_depth != _arena._scope_depth)
+		{
+			frame_arena::_report("scoped_arena allocates while an inner scope is alive");
+		}
+	}
+};
+
+CORE_NAMESPACE_END
+
+#endif
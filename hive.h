@@ -0,0 +1,509 @@
+
+#ifndef HIVE_H
+#define HIVE_H
+
+#include "core.h"
+#include "noncopyable.h"
+#include "allocator.h"
+#include "mem_cell.h"
+#include "sfinae_macros.h"
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <iterator>
+#include <new>
+#include <string.h>
+
+CORE_NAMESPACE_BEG
+
+/// <summary>
+/// unordered container with stable element addresses: elements live in blocks that never move,
+/// erased slots are reused by later inserts, and iteration skips erased runs in O(1) with a jump-counting skipfield.
+/// a block is freed as soon as its last element is erased
+/// </summary>
+template<typename _T, typename _Alloc = allocator<_T>>
+class hive {
+	static_assert(alignof(_T) <= alignof(mem_cell::align_type), "_T is over-aligned for mem_pool");
+
+	using _skip_type = uint16_t;
+	static const _skip_type _NoRun = static_cast<_skip_type>(~0);
+
+	// an erased slot holds the links of the free run list, runs are reused from their first slot
+	struct _run_link {
+		_skip_type prev;
+		_skip_type next;
+	};
+	union _slot {
+		alignas(_T) unsigned char value_buf[sizeof(_T)];
+		_run_link link;
+
+		inline _T* value() { return reinterpret_cast<_T*>(value_buf); }
+	};
+
+	struct _block {
+		_block* prev;
+		_block* next;
+		_block* prev_erased;
+		_block* next_erased;
+		_slot* slots;
+		// capacity + 1 entries, the extra 0 stops forward jumps at the end of the block
+		_skip_type* skips;
+		size_t capacity;
+		// slots [0, high) have been used, slots beyond are never constructed
+		size_t high;
+		size_t size;
+		_skip_type run_head;
+	};
+
+	using _byte_allocator_type = typename std::allocator_traits<_Alloc>::template rebind_alloc<unsigned char>;
+	using _byte_alloc_traits = std::allocator_traits<_byte_allocator_type>;
+
+public:
+	static const size_t MinBlockCapacity = 8;
+	static const size_t MaxBlockCapacity = 8192;
+
+	using value_type = _T;
+	using size_type = size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = _T&;
+	using const_reference = const _T&;
+	using pointer = _T*;
+	using const_pointer = const _T*;
+	using allocator_type = _Alloc;
+
+	template<typename _V>
+	class _iterator {
+		friend class hive;
+		template<typename _U>
+		friend class _iterator;
+
+		_block* _b;
+		size_t _index;
+
+		inline _iterator(_block* b, size_t index) : _b(b), _index(index) {}
+
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = _T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = _V*;
+		using reference = _V&;
+
+		inline _iterator() : _b(nullptr), _index(0) {}
+		template<typename _U, enable_if_int<std::is_convertible<_U*, _V*>::value> = 0>
+		inline _iterator(const _iterator<_U>& other) : _b(other._b), _index(other._index) {}
+
+		inline reference operator*() const { return *_b->slots[_index].value(); }
+		inline pointer operator->() const { return _b->slots[_index].value(); }
+		inline _iterator& operator++()
+		{
+			++_index;
+			_index += _b->skips[_index];
+			if (_index == _b->high && nullptr != _b->next)
+			{
+				_b = _b->next;
+				_index = _b->skips[0];
+			}
+			return *this;
+		}
+		inline _iterator operator++(int)
+		{
+			auto tmp = *this;
+			++*this;
+			return tmp;
+		}
+		inline _iterator& operator--()
+		{
+			if (0 == _index || _index == _b->skips[_index - 1])
+			{
+				// the rest of this block before _index is erased
+				_b = _b->prev;
+				_index = _b->high;
+			}
+			_index -= 1 + _b->skips[_index - 1];
+			return *this;
+		}
+		inline _iterator operator--(int)
+		{
+			auto tmp = *this;
+			--*this;
+			return tmp;
+		}
+		inline bool operator==(const _iterator& rhs) const { return _b == rhs._b && _index == rhs._index; }
+		inline bool operator!=(const _iterator& rhs) const { return !operator==(rhs); }
+	};
+	using iterator = _iterator<_T>;
+	using const_iterator = _iterator<const _T>;
+
+private:
+	_block* _first;
+	_block* _last;
+	_block* _erased_blocks;
+	size_t _size;
+	size_t _next_block_capacity;
+	_byte_allocator_type _alloc;
+
+public:
+	inline hive() : _first(nullptr), _last(nullptr), _erased_blocks(nullptr), _size(0), _next_block_capacity(MinBlockCapacity), _alloc() {}
+	hive(const hive& other) : hive()
+	{
+		for (auto& value : other)
+		{
+			emplace(value);
+		}
+	}
+	hive(hive&& other) noexcept : hive()
+	{
+		swap(other);
+	}
+	~hive()
+	{
+		clear();
+	}
+
+	hive& operator=(const hive& other)
+	{
+		if (this != &other)
+		{
+			hive(other).swap(*this);
+		}
+		return *this;
+	}
+	hive& operator=(hive&& other) noexcept
+	{
+		if (this != &other)
+		{
+			hive(std::move(other)).swap(*this);
+		}
+		return *this;
+	}
+
+	void swap(hive& other) noexcept
+	{
+		std::swap(_first, other._first);
+		std::swap(_last, other._last);
+		std::swap(_erased_blocks, other._erased_blocks);
+		std::swap(_size, other._size);
+		std::swap(_next_block_capacity, other._next_block_capacity);
+	}
+
+public:
+	inline iterator begin() { return nullptr == _first ? iterator() : iterator(_first, _first->skips[0]); }
+	inline const_iterator begin() const { return const_cast<hive*>(this)->begin(); }
+	inline iterator end() { return nullptr == _last ? iterator() : iterator(_last, _last->high); }
+	inline const_iterator end() const { return const_cast<hive*>(this)->end(); }
+
+	inline size_t size() const { return _size; }
+	inline bool empty() const { return 0 == _size; }
+	size_t capacity() const
+	{
+		size_t capacity = 0;
+		for (auto b = _first; nullptr != b; b = b->next)
+		{
+			capacity += b->capacity;
+		}
+		return capacity;
+	}
+
+	/// <summary>
+	/// iterator of an element in this hive, walks the blocks to find the one holding p
+	/// </summary>
+	iterator get_iterator(const _T* p)
+	{
+		auto address = reinterpret_cast<intptr_t>(p);
+		for (auto b = _first; nullptr != b; b = b->next)
+		{
+			auto beg = reinterpret_cast<intptr_t>(b->slots);
+			if (beg <= address && address < beg + static_cast<intptr_t>(sizeof(_slot) * b->high))
+			{
+				return iterator(b, static_cast<size_t>(address - beg) / sizeof(_slot));
+			}
+		}
+		return end();
+	}
+
+public:
+	/// <summary>
+	/// reuses an erased slot if there is one, existing elements never move
+	/// </summary>
+	template<typename ..._Args>
+	iterator emplace(_Args&&... args)
+	{
+		if (nullptr != _erased_blocks)
+		{
+			auto b = _erased_blocks;
+			auto index = static_cast<size_t>(b->run_head);
+			auto run_size = b->skips[index];
+			auto link = b->slots[index].link;
+			::new(static_cast<void*>(b->slots[index].value())) _T(std::forward<_Args>(args)...);
+
+			// the slot now holds the element, the run bookkeeping works from the saved link
+			if (1 == run_size)
+			{
+				_remove_run(b, link);
+			}
+			else
+			{
+				// the run now starts one slot later
+				b->skips[index + 1] = static_cast<_skip_type>(run_size - 1);
+				b->skips[index + run_size - 1] = static_cast<_skip_type>(run_size - 1);
+				_move_run(b, link, index + 1);
+			}
+			b->skips[index] = 0;
+			++b->size;
+			++_size;
+			return iterator(b, index);
+		}
+
+		if (nullptr == _last || _last->high == _last->capacity)
+		{
+			_append_block();
+		}
+		auto b = _last;
+		::new(static_cast<void*>(b->slots[b->high].value())) _T(std::forward<_Args>(args)...);
+		++b->high;
+		++b->size;
+		++_size;
+		return iterator(b, b->high - 1);
+	}
+	inline iterator insert(const _T& value) { return emplace(value); }
+	inline iterator insert(_T&& value) { return emplace(std::move(value)); }
+
+	/// <summary>
+	/// returns the next element, other iterators stay valid unless their block is freed
+	/// </summary>
+	iterator erase(const_iterator pos)
+	{
+		auto b = pos._b;
+		auto index = pos._index;
+		b->slots[index].value()->~_T();
+		--b->size;
+		--_size;
+
+		if (0 == b->size)
+		{
+			auto next = b->next;
+			_free_block(b);
+			return nullptr == next ? end() : iterator(next, next->skips[0]);
+		}
+
+		auto skips = b->skips;
+		size_t left = 0 < index ? skips[index - 1] : 0;
+		size_t right = skips[index + 1];
+		if (0 == left && 0 == right)
+		{
+			skips[index] = 1;
+			_add_run(b, index);
+		}
+		else if (0 == right)
+		{
+			// extend the run that ends right before index
+			auto run_size = static_cast<_skip_type>(left + 1);
+			skips[index - left] = run_size;
+			skips[index] = run_size;
+		}
+		else if (0 == left)
+		{
+			// extend the run that starts right after index, its start moves to index
+			auto run_size = static_cast<_skip_type>(right + 1);
+			skips[index] = run_size;
+			skips[index + right] = run_size;
+			_move_run(b, b->slots[index + 1].link, index);
+		}
+		else
+		{
+			// join both runs, the right one leaves the run list
+			auto run_size = static_cast<_skip_type>(left + right + 1);
+			skips[index - left] = run_size;
+			skips[index + right] = run_size;
+			_remove_run(b, b->slots[index + 1].link);
+		}
+
+		auto next = index + right + 1;
+		if (next == b->high && nullptr != b->next)
+		{
+			return iterator(b->next, b->next->skips[0]);
+		}
+		return iterator(b, next);
+	}
+
+	void clear()
+	{
+		auto b = _first;
+		while (nullptr != b)
+		{
+			auto next = b->next;
+			for (size_t i = b->skips[0]; i < b->high; i += 1 + b->skips[i + 1])
+			{
+				b->slots[i].value()->~_T();
+			}
+			_dealloc_block(b);
+			b = next;
+		}
+		_first = nullptr;
+		_last = nullptr;
+		_erased_blocks = nullptr;
+		_size = 0;
+	}
+
+private: // run list, linked through the first slot of each erased run
+	void _add_run(_block* b, size_t index)
+	{
+		auto& link = b->slots[index].link;
+		link.prev = _NoRun;
+		link.next = b->run_head;
+		if (_NoRun != b->run_head)
+		{
+			b->slots[b->run_head].link.prev = static_cast<_skip_type>(index);
+		}
+		else
+		{
+			// first run of the block
+			b->prev_erased = nullptr;
+			b->next_erased = _erased_blocks;
+			if (nullptr != _erased_blocks)
+			{
+				_erased_blocks->prev_erased = b;
+			}
+			_erased_blocks = b;
+		}
+		b->run_head = static_cast<_skip_type>(index);
+	}
+
+	void _remove_run(_block* b, _run_link link)
+	{
+		if (_NoRun != link.prev)
+		{
+			b->slots[link.prev].link.next = link.next;
+		}
+		else
+		{
+			b->run_head = link.next;
+		}
+		if (_NoRun != link.next)
+		{
+			b->slots[link.next].link.prev = link.prev;
+		}
+		if (_NoRun == b->run_head)
+		{
+			_remove_erased_block(b);
+		}
+	}
+
+	void _move_run(_block* b, _run_link link, size_t to)
+	{
+		b->slots[to].link = link;
+		if (_NoRun != link.prev)
+		{
+			b->slots[link.prev].link.next = static_cast<_skip_type>(to);
+		}
+		else
+		{
+			b->run_head = static_cast<_skip_type>(to);
+		}
+		if (_NoRun != link.next)
+		{
+			b->slots[link.next].link.prev = static_cast<_skip_type>(to);
+		}
+	}
+
+	void _remove_erased_block(_block* b)
+	{
+		if (nullptr != b->prev_erased)
+		{
+			b->prev_erased->next_erased = b->next_erased;
+		}
+		else
+		{
+			_erased_blocks = b->next_erased;
+		}
+		if (nullptr != b->next_erased)
+		{
+			b->next_erased->prev_erased = b->prev_erased;
+		}
+		b->prev_erased = nullptr;
+		b->next_erased = nullptr;
+	}
+
+private: // blocks
+	inline static size_t _slots_offset()
+	{
+		return (sizeof(_block) + alignof(_slot) - 1) / alignof(_slot) * alignof(_slot);
+	}
+	inline static size_t _skips_offset(size_t capacity)
+	{
+		return (_slots_offset() + sizeof(_slot) * capacity + alignof(_skip_type) - 1) / alignof(_skip_type) * alignof(_skip_type);
+	}
+	inline static size_t _block_mem_size(size_t capacity)
+	{
+		return _skips_offset(capacity) + sizeof(_skip_type) * (capacity + 1);
+	}
+
+	void _append_block()
+	{
+		auto capacity = _next_block_capacity;
+		if (MaxBlockCapacity > _next_block_capacity)
+		{
+			_next_block_capacity *= 2;
+		}
+
+		// header, slots and skipfield share one allocation
+		auto mem = _byte_alloc_traits::allocate(_alloc, _block_mem_size(capacity));
+		auto b = ::new(static_cast<void*>(mem)) _block;
+		b->slots = reinterpret_cast<_slot*>(mem + _slots_offset());
+		b->skips = reinterpret_cast<_skip_type*>(mem + _skips_offset(capacity));
+		memset(b->skips, 0, sizeof(_skip_type) * (capacity + 1));
+		b->capacity = capacity;
+		b->high = 0;
+		b->size = 0;
+		b->run_head = _NoRun;
+		b->prev_erased = nullptr;
+		b->next_erased = nullptr;
+
+		b->prev = _last;
+		b->next = nullptr;
+		if (nullptr != _last)
+		{
+			_last->next = b;
+		}
+		else
+		{
+			_first = b;
+		}
+		_last = b;
+	}
+
+	void _free_block(_block* b)
+	{
+		if (_NoRun != b->run_head)
+		{
+			_remove_erased_block(b);
+		}
+		if (nullptr != b->prev)
+		{
+			b->prev->next = b->next;
+		}
+		else
+		{
+			_first = b->next;
+		}
+		if (nullptr != b->next)
+		{
+			b->next->prev = b->prev;
+		}
+		else
+		{
+			_last = b->prev;
+		}
+		_dealloc_block(b);
+	}
+
+	void _dealloc_block(_block* b)
+	{
+		_byte_alloc_traits::deallocate(_alloc, reinterpret_cast<unsigned char*>(b), _block_mem_size(b->capacity));
+	}
+};
+
+CORE_NAMESPACE_END
+
+#endif
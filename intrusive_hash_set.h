@@ -0,0 +1,282 @@
+
+#ifndef INTRUSIVE_HASH_SET_H
+#define INTRUSIVE_HASH_SET_H
+
+#include "core.h"
+#include "noncopyable.h"
+#include "allocator.h"
+#include "sfinae_macros.h"
+#include <memory>
+#include <functional>
+#include <iterator>
+#include <string.h>
+
+CORE_NAMESPACE_BEG
+
+/// <summary>
+/// embedded in an element to let it join one intrusive_hash_set, the element caches its hash here.
+/// an element must be removed from its set before it is destroyed
+/// </summary>
+class intrusive_hash_hook : noncopyable {
+	template<typename _T, intrusive_hash_hook _T::* _Hook, typename _Hash, typename _Eq, typename _Alloc>
+	friend class intrusive_hash_set;
+
+	intrusive_hash_hook* _next;
+	size_t _hash;
+	bool _linked;
+
+public:
+	inline intrusive_hash_hook() : _next(nullptr), _hash(0), _linked(false) {}
+
+public:
+	inline bool is_linked() const { return _linked; }
+};
+
+/// <summary>
+/// chained hash set threaded through the _Hook member of its elements: only the bucket array is allocated, never a node.
+/// the set doesn't own the elements, clear() only unlinks them.
+/// find takes any key that _Hash and _Eq accept, so elements can be looked up by id without building one
+/// </summary>
+template<typename _T, intrusive_hash_hook _T::* _Hook, typename _Hash = std::hash<_T>, typename _Eq = std::equal_to<_T>, typename _Alloc = allocator<intrusive_hash_hook*>>
+class intrusive_hash_set final : noncopyable {
+	using _bucket_type = intrusive_hash_hook*;
+	using _alloc_traits = typename std::allocator_traits<_Alloc>::template rebind_traits<_bucket_type>;
+	using _allocator_type = typename std::allocator_traits<_Alloc>::template rebind_alloc<_bucket_type>;
+
+	static const size_t _MinBucketCount = 16;
+
+	_bucket_type* _buckets;
+	size_t _bucket_mask;
+	size_t _size;
+	_Hash _hash;
+	_Eq _eq;
+	_allocator_type _alloc;
+
+public:
+	template<typename _V>
+	class _iterator {
+		friend class intrusive_hash_set;
+		template<typename _U>
+		friend class _iterator;
+
+		const intrusive_hash_set* _set;
+		intrusive_hash_hook* _hook;
+		size_t _bucket_index;
+
+		inline _iterator(const intrusive_hash_set* set, intrusive_hash_hook* hook, size_t bucket_index)
+			: _set(set), _hook(hook), _bucket_index(bucket_index)
+		{
+		}
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = _T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = _V*;
+		using reference = _V&;
+
+		inline _iterator() : _set(nullptr), _hook(nullptr), _bucket_index(0) {}
+		template<typename _U, enable_if_int<std::is_convertible<_U*, _V*>::value> = 0>
+		inline _iterator(const _iterator<_U>& other) : _set(other._set), _hook(other._hook), _bucket_index(other._bucket_index) {}
+
+		inline reference operator*() const { return *_owner_of(_hook); }
+		inline pointer operator->() const { return _owner_of(_hook); }
+		inline _iterator& operator++()
+		{
+			_hook = _hook->_next;
+			if (nullptr == _hook)
+			{
+				*this = _set->_first_from(_bucket_index + 1);
+			}
+			return *this;
+		}
+		inline _iterator operator++(int)
+		{
+			auto tmp = *this;
+			++*this;
+			return tmp;
+		}
+		inline bool operator==(const _iterator& rhs) const { return _hook == rhs._hook; }
+		inline bool operator!=(const _iterator& rhs) const { return _hook != rhs._hook; }
+	};
+	using iterator = _iterator<_T>;
+	using const_iterator = _iterator<const _T>;
+
+public:
+	explicit intrusive_hash_set(const _Hash& hash = _Hash(), const _Eq& eq = _Eq())
+		: _buckets(nullptr)
+		, _bucket_mask(0)
+		, _size(0)
+		, _hash(hash)
+		, _eq(eq)
+		, _alloc()
+	{
+	}
+	~intrusive_hash_set()
+	{
+		clear();
+		if (nullptr != _buckets)
+		{
+			_alloc_traits::deallocate(_alloc, _buckets, _bucket_mask + 1);
+		}
+	}
+
+public:
+	inline iterator begin() { return _first_from(0); }
+	inline const_iterator begin() const { return _first_from(0); }
+	inline iterator end() { return iterator(this, nullptr, 0); }
+	inline const_iterator end() const { return const_iterator(this, nullptr, 0); }
+
+	inline size_t size() const { return _size; }
+	inline bool empty() const { return 0 == _size; }
+	inline size_t bucket_count() const { return nullptr == _buckets ? 0 : _bucket_mask + 1; }
+
+public:
+	template<typename _K>
+	_T* find(const _K& key) const
+	{
+		if (0 == _size)
+		{
+			return nullptr;
+		}
+		auto hash = _hash_of(key);
+		for (auto hook = _buckets[hash & _bucket_mask]; nullptr != hook; hook = hook->_next)
+		{
+			if (hash == hook->_hash && _eq(key, *_owner_of(hook)))
+			{
+				return _owner_of(hook);
+			}
+		}
+		return nullptr;
+	}
+	template<typename _K>
+	inline bool contains(const _K& key) const { return nullptr != find(key); }
+
+	/// <summary>
+	/// value must not be linked into any set
+	/// </summary>
+	/// <returns>false if an equal element is already in the set</returns>
+	bool insert(_T& value)
+	{
+		if (contains(value))
+		{
+			return false;
+		}
+		if (_size >= bucket_count())
+		{
+			_rehash(0 == bucket_count() ? _MinBucketCount : bucket_count() * 2);
+		}
+		auto hook = &(value.*_Hook);
+		hook->_hash = _hash_of(value);
+		hook->_linked = true;
+		auto& bucket = _buckets[hook->_hash & _bucket_mask];
+		hook->_next = bucket;
+		bucket = hook;
+		++_size;
+		return true;
+	}
+
+	/// <summary>
+	/// value must be in this set, costs one walk of its bucket chain
+	/// </summary>
+	void remove(_T& value)
+	{
+		auto hook = &(value.*_Hook);
+		auto p_link = &_buckets[hook->_hash & _bucket_mask];
+		while (*p_link != hook)
+		{
+			p_link = &(*p_link)->_next;
+		}
+		*p_link = hook->_next;
+		hook->_next = nullptr;
+		hook->_linked = false;
+		--_size;
+	}
+
+	template<typename _K>
+	size_t erase(const _K& key)
+	{
+		auto p = find(key);
+		if (nullptr == p)
+		{
+			return 0;
+		}
+		remove(*p);
+		return 1;
+	}
+
+	void clear()
+	{
+		for (size_t i = 0; i < bucket_count(); ++i)
+		{
+			auto hook = _buckets[i];
+			while (nullptr != hook)
+			{
+				auto next = hook->_next;
+				hook->_next = nullptr;
+				hook->_linked = false;
+				hook = next;
+			}
+			_buckets[i] = nullptr;
+		}
+		_size = 0;
+	}
+
+private:
+	template<typename _K>
+	inline size_t _hash_of(const _K& key) const
+	{
+		// pointers and sequential ids leave the low bits poorly spread, mix before masking
+		auto h = static_cast<uint64_t>(_hash(key)) * 0x9E3779B97F4A7C15ull;
+		return static_cast<size_t>(h ^ (h >> 32));
+	}
+
+	inline static _T* _owner_of(intrusive_hash_hook* hook)
+	{
+		// offset of the hook member, computed on a fake aligned address instead of nullptr
+		const intptr_t fake_address = 0x1000;
+		auto offset = reinterpret_cast<intptr_t>(&(reinterpret_cast<_T*>(fake_address)->*_Hook)) - fake_address;
+		return reinterpret_cast<_T*>(reinterpret_cast<intptr_t>(hook) - offset);
+	}
+
+	iterator _first_from(size_t bucket_index) const
+	{
+		for (; bucket_index < bucket_count(); ++bucket_index)
+		{
+			if (nullptr != _buckets[bucket_index])
+			{
+				return iterator(this, _buckets[bucket_index], bucket_index);
+			}
+		}
+		return iterator(this, nullptr, 0);
+	}
+
+	void _rehash(size_t new_bucket_count)
+	{
+		auto new_buckets = _alloc_traits::allocate(_alloc, new_bucket_count);
+		memset(new_buckets, 0, sizeof(_bucket_type) * new_bucket_count);
+		auto new_mask = new_bucket_count - 1;
+		for (size_t i = 0; i < bucket_count(); ++i)
+		{
+			auto hook = _buckets[i];
+			while (nullptr != hook)
+			{
+				auto next = hook->_next;
+				auto& bucket = new_buckets[hook->_hash & new_mask];
+				hook->_next = bucket;
+				bucket = hook;
+				hook = next;
+			}
+		}
+		if (nullptr != _buckets)
+		{
+			_alloc_traits::deallocate(_alloc, _buckets, _bucket_mask + 1);
+		}
+		_buckets = new_buckets;
+		_bucket_mask = new_mask;
+	}
+};
+
+CORE_NAMESPACE_END
+
+#endif
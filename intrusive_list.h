@@ -0,0 +1,183 @@
+
+#ifndef INTRUSIVE_LIST_H
+#define INTRUSIVE_LIST_H
+
+#include "core.h"
+#include "noncopyable.h"
+#include "sfinae_macros.h"
+#include <iterator>
+
+CORE_NAMESPACE_BEG
+
+/// <summary>
+/// embedded in an element to let it join one intrusive_list, the list never allocates.
+/// an element must be removed from its list before it is destroyed
+/// </summary>
+class intrusive_list_hook : noncopyable {
+	template<typename _T, intrusive_list_hook _T::* _Hook>
+	friend class intrusive_list;
+
+	intrusive_list_hook* _prev;
+	intrusive_list_hook* _next;
+
+public:
+	inline intrusive_list_hook() : _prev(nullptr), _next(nullptr) {}
+
+public:
+	inline bool is_linked() const { return nullptr != _next; }
+};
+
+template<typename _T, intrusive_list_hook _T::* _Hook>
+inline _T* _intrusive_owner_of(intrusive_list_hook* hook)
+{
+	// offset of the hook member, computed on a fake aligned address instead of nullptr
+	const intptr_t fake_address = 0x1000;
+	auto offset = reinterpret_cast<intptr_t>(&(reinterpret_cast<_T*>(fake_address)->*_Hook)) - fake_address;
+	return reinterpret_cast<_T*>(reinterpret_cast<intptr_t>(hook) - offset);
+}
+
+/// <summary>
+/// doubly linked list threaded through the _Hook member of its elements: insert and erase are O(1) and allocation free.
+/// the list doesn't own the elements, clear() only unlinks them
+/// </summary>
+template<typename _T, intrusive_list_hook _T::* _Hook>
+class intrusive_list final : noncopyable {
+	intrusive_list_hook _head;
+	size_t _size;
+
+public:
+	template<typename _V>
+	class _iterator {
+		friend class intrusive_list;
+		template<typename _U>
+		friend class _iterator;
+
+		intrusive_list_hook* _hook;
+
+		inline explicit _iterator(intrusive_list_hook* hook) : _hook(hook) {}
+
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = _T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = _V*;
+		using reference = _V&;
+
+		inline _iterator() : _hook(nullptr) {}
+		template<typename _U, enable_if_int<std::is_convertible<_U*, _V*>::value> = 0>
+		inline _iterator(const _iterator<_U>& other) : _hook(other._hook) {}
+
+		inline reference operator*() const { return *_intrusive_owner_of<_T, _Hook>(_hook); }
+		inline pointer operator->() const { return _intrusive_owner_of<_T, _Hook>(_hook); }
+		inline _iterator& operator++()
+		{
+			_hook = _hook->_next;
+			return *this;
+		}
+		inline _iterator operator++(int)
+		{
+			auto tmp = *this;
+			_hook = _hook->_next;
+			return tmp;
+		}
+		inline _iterator& operator--()
+		{
+			_hook = _hook->_prev;
+			return *this;
+		}
+		inline _iterator operator--(int)
+		{
+			auto tmp = *this;
+			_hook = _hook->_prev;
+			return tmp;
+		}
+		inline bool operator==(const _iterator& rhs) const { return _hook == rhs._hook; }
+		inline bool operator!=(const _iterator& rhs) const { return _hook != rhs._hook; }
+	};
+	using iterator = _iterator<_T>;
+	using const_iterator = _iterator<const _T>;
+
+public:
+	inline intrusive_list() : _head(), _size(0)
+	{
+		_head._prev = &_head;
+		_head._next = &_head;
+	}
+	inline ~intrusive_list()
+	{
+		clear();
+	}
+
+public:
+	inline iterator begin() { return iterator(_head._next); }
+	inline const_iterator begin() const { return const_iterator(_head._next); }
+	inline iterator end() { return iterator(&_head); }
+	inline const_iterator end() const { return const_iterator(const_cast<intrusive_list_hook*>(&_head)); }
+
+	inline size_t size() const { return _size; }
+	inline bool empty() const { return 0 == _size; }
+
+	inline _T& front() { return *begin(); }
+	inline _T& back() { return *iterator(_head._prev); }
+
+	/// <summary>
+	/// iterator of an element that is in this list
+	/// </summary>
+	inline static iterator iterator_to(_T& value) { return iterator(&(value.*_Hook)); }
+
+public:
+	inline void push_front(_T& value) { insert(begin(), value); }
+	inline void push_back(_T& value) { insert(end(), value); }
+	inline void pop_front() { erase(begin()); }
+	inline void pop_back() { erase(iterator(_head._prev)); }
+
+	/// <summary>
+	/// value must not be linked into any list
+	/// </summary>
+	iterator insert(const_iterator pos, _T& value)
+	{
+		auto hook = &(value.*_Hook);
+		auto next = pos._hook;
+		hook->_prev = next->_prev;
+		hook->_next = next;
+		next->_prev->_next = hook;
+		next->_prev = hook;
+		++_size;
+		return iterator(hook);
+	}
+
+	iterator erase(const_iterator pos)
+	{
+		auto hook = pos._hook;
+		auto next = hook->_next;
+		hook->_prev->_next = next;
+		next->_prev = hook->_prev;
+		hook->_prev = nullptr;
+		hook->_next = nullptr;
+		--_size;
+		return iterator(next);
+	}
+	/// <summary>
+	/// value must be in this list
+	/// </summary>
+	inline void remove(_T& value) { erase(iterator_to(value)); }
+
+	void clear()
+	{
+		auto hook = _head._next;
+		while (&_head != hook)
+		{
+			auto next = hook->_next;
+			hook->_prev = nullptr;
+			hook->_next = nullptr;
+			hook = next;
+		}
+		_head._prev = &_head;
+		_head._next = &_head;
+		_size = 0;
+	}
+};
+
+CORE_NAMESPACE_END
+
+#endif
@@ -7,6 +7,12 @@
 
 #define USER_MEM_ALIGN 1
 #define COMPACT_CELL 1
+// the spare header bytes of an aligned cell hold a generation
+#define CELL_GENERATION USER_MEM_ALIGN
+
+#if CELL_GENERATION && defined(_MSC_VER)
+#include <intrin.h>
+#endif // CELL_GENERATION && _MSC_VER
 
 CORE_NAMESPACE_BEG
 
@@ -74,6 +80,45 @@ public:
 		return !is_unused();
 	}
 
+#if CELL_GENERATION
+	/// <summary>
+	/// lives in the header bytes after head, which alloc and free leave alone, so it outlives what the cell holds.
+	/// a plain uint16_t, no std::atomic is ever constructed there; other threads may read it, so go through the helpers below
+	/// </summary>
+	inline uint16_t* generation()
+	{
+		static_assert(sizeof(head_type) + sizeof(uint16_t) <= sizeof(align_type), "no room for the generation");
+		return reinterpret_cast<uint16_t*>((intptr_t)this + sizeof(align_type) - sizeof(uint16_t));
+	}
+
+	inline static uint16_t load_generation(const uint16_t* p_generation)
+	{
+#if defined(_MSC_VER)
+		return (uint16_t)__iso_volatile_load16((const volatile short*)p_generation);
+#else
+		return __atomic_load_n(p_generation, __ATOMIC_RELAXED);
+#endif // _MSC_VER
+	}
+
+	inline static void store_generation(uint16_t* p_generation, uint16_t generation)
+	{
+#if defined(_MSC_VER)
+		__iso_volatile_store16((volatile short*)p_generation, (short)generation);
+#else
+		__atomic_store_n(p_generation, generation, __ATOMIC_RELAXED);
+#endif // _MSC_VER
+	}
+
+	inline static void bump_generation(uint16_t* p_generation)
+	{
+#if defined(_MSC_VER)
+		_InterlockedIncrement16((volatile short*)p_generation);
+#else
+		__atomic_fetch_add(p_generation, (uint16_t)1, __ATOMIC_RELAXED);
+#endif // _MSC_VER
+	}
+#endif // CELL_GENERATION
+
 	inline static mem_cell& get_cell(void* user_mem)
 	{
 		return *(mem_cell*)((intptr_t)user_mem - UserMemOffset);
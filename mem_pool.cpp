@@ -3,6 +3,6 @@
 
 CORE_NAMESPACE_BEG
 
-mem_pool* mem_pool_utils::p_mem_pool = nullptr;
+ENVIRONMENT_STORAGE mem_pool* mem_pool_utils::p_mem_pool = nullptr;
 
 CORE_NAMESPACE_END
\ No newline at end of file
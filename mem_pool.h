@@ -11,8 +11,9 @@ using large_mem_pool = mem_pool_configable<
 	mem_pool::info_for_global::max_cell_size + mem_pool::info_for_global::cell_unit_size, 
 	mem_pool::info_for_global::block_max_size>;
 
+// the pool of the containers, per thread when ENABLE_THREAD_LOCAL_ENVIRONMENT. set by the first object_factory constructed on the thread
 struct mem_pool_utils {
-	static mem_pool* p_mem_pool;
+	static ENVIRONMENT_STORAGE mem_pool* p_mem_pool;
 	template<typename _T>
 	inline static void* alloc()
 	{
@@ -30,6 +31,11 @@ struct mem_pool_utils {
 	{
 		return p_mem_pool->free(user_mem);
 	}
+	template<typename _T>
+	inline static bool free(void* user_mem)
+	{
+		return p_mem_pool->free<_T>(user_mem);
+	}
 };
 
 CORE_NAMESPACE_END
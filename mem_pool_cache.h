@@ -0,0 +1,164 @@
+
+#ifndef MEM_POOL_CACHE_H
+#define MEM_POOL_CACHE_H
+
+#include "core.h"
+#include "noncopyable.h"
+#include "mem_cell.h"
+#include "mem_pool.h"
+#include <mutex>
+#include <string.h>
+
+CORE_NAMESPACE_BEG
+
+/// <summary>
+/// per-thread front of a mem_pool shared by several threads. cells move between the cache and the pool in batches
+/// under the pool mutex, so most alloc and free calls touch no shared state.
+/// a cell may be freed into any cache of the same pool, cells of one size are interchangeable
+/// </summary>
+class mem_pool_cache final : noncopyable {
+	struct _free_cell {
+		_free_cell* next;
+	};
+
+	mem_pool& _pool;
+	std::mutex& _pool_mutex;
+	_free_cell* _heads[mem_cell::PoolCount];
+	size_t _counts[mem_cell::PoolCount];
+
+public:
+	static const size_t BatchCount = 32;
+	static const size_t MaxCachedCount = BatchCount * 2;
+
+	mem_pool_cache(mem_pool& pool, std::mutex& pool_mutex)
+		: _pool(pool)
+		, _pool_mutex(pool_mutex)
+		, _heads()
+		, _counts()
+	{
+	}
+	~mem_pool_cache()
+	{
+		flush();
+	}
+
+public:
+	template<typename _T>
+	inline void* alloc()
+	{
+		const size_t pool_index = mem_pool::info_for_type<_T>::pool_index;
+		auto p_cell = _heads[pool_index];
+		if (nullptr == p_cell)
+		{
+			return _refill<_T>();
+		}
+		_heads[pool_index] = p_cell->next;
+		--_counts[pool_index];
+		// the rest of the cell was cleaned when it was freed
+		p_cell->next = nullptr;
+		return p_cell;
+	}
+
+	/// <summary>
+	/// up to count cells into mems, cached ones first and the rest from the pool under one lock.
+	/// returns how many were allocated
+	/// </summary>
+	template<typename _T>
+	size_t alloc_batch(void** mems, size_t count)
+	{
+		const size_t pool_index = mem_pool::info_for_type<_T>::pool_index;
+		size_t alloc_count = 0;
+		for (; alloc_count < count && nullptr != _heads[pool_index]; ++alloc_count)
+		{
+			auto p_cell = _heads[pool_index];
+			_heads[pool_index] = p_cell->next;
+			--_counts[pool_index];
+			p_cell->next = nullptr;
+			mems[alloc_count] = p_cell;
+		}
+		if (alloc_count < count)
+		{
+			std::lock_guard<std::mutex> lock(_pool_mutex);
+			for (; alloc_count < count; ++alloc_count)
+			{
+				auto user_mem = _pool.alloc<_T>();
+				if (nullptr == user_mem)
+				{
+					break;
+				}
+				mems[alloc_count] = user_mem;
+			}
+		}
+		return alloc_count;
+	}
+
+	/// <summary>
+	/// user_mem must come from alloc() of a cache of the same pool
+	/// </summary>
+	inline void free(void* user_mem)
+	{
+		auto pool_index = static_cast<size_t>(mem_cell::get_cell(user_mem).head);
+#if MEM_RAW_POOL_CLEAN_MEM
+		memset(user_mem, 0, mem_pool::user_mem_size_of_pool(pool_index));
+#endif
+		auto p_cell = static_cast<_free_cell*>(user_mem);
+		p_cell->next = _heads[pool_index];
+		_heads[pool_index] = p_cell;
+		if (MaxCachedCount < ++_counts[pool_index])
+		{
+			_give_back(pool_index, BatchCount);
+		}
+	}
+
+	/// <summary>
+	/// gives every cached cell back to the pool
+	/// </summary>
+	void flush()
+	{
+		for (size_t i = 0; i < mem_cell::PoolCount; ++i)
+		{
+			if (0 < _counts[i])
+			{
+				_give_back(i, 0);
+			}
+		}
+	}
+
+	inline size_t cached_count(size_t pool_index) const { return _counts[pool_index]; }
+
+private:
+	template<typename _T>
+	void* _refill()
+	{
+		const size_t pool_index = mem_pool::info_for_type<_T>::pool_index;
+		std::lock_guard<std::mutex> lock(_pool_mutex);
+		for (size_t i = 1; i < BatchCount; ++i)
+		{
+			auto p_cell = static_cast<_free_cell*>(_pool.alloc<_T>());
+			if (nullptr == p_cell)
+			{
+				break;
+			}
+			p_cell->next = _heads[pool_index];
+			_heads[pool_index] = p_cell;
+			++_counts[pool_index];
+		}
+		return _pool.alloc<_T>();
+	}
+
+	void _give_back(size_t pool_index, size_t keep_count)
+	{
+		std::lock_guard<std::mutex> lock(_pool_mutex);
+		while (keep_count < _counts[pool_index])
+		{
+			auto p_cell = _heads[pool_index];
+			_heads[pool_index] = p_cell->next;
+			--_counts[pool_index];
+			_pool.free(p_cell);
+		}
+	}
+};
+
+CORE_NAMESPACE_END
+
+#endif
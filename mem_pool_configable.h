@@ -9,7 +9,8 @@
 #include "mem_raw_pool.h"
 #include "environment.h"
 #include "bug_reporter.h"
-#include <memory>
+#include <string.h>
+#include <algorithm>
 
 CORE_NAMESPACE_BEG
 
@@ -28,63 +29,106 @@ class mem_pool_configable : noncopyable {
 
 	using _config = mem_pool_config<_CellUnitSize, _BlockMaxSize>;
 
-	using _pool_pointer_type = std::unique_ptr<mem_raw_pool>;
-
-	_pool_pointer_type _pools[mem_cell::PoolCount];
+	// raw pools live inline: constructing one allocates nothing, blocks are created on first alloc
+	mem_raw_pool _pools[mem_cell::PoolCount];
 	size_t _cleanup_index = 0;
+	size_t _compact_index = 0;
 
 	inline mem_raw_pool* _get_pool(void* user_mem)
 	{
 		auto i = static_cast<size_t>(mem_cell::get_cell(user_mem).head);
-		return mem_cell::PoolCount > i ? _pools[i].get() : nullptr;
+		return mem_cell::PoolCount > i ? &_pools[i] : nullptr;
 	}
 
-	template<size_t _PoolIndex>
-	struct _pool_creater {
-		inline static void create(_pool_pointer_type pools[])
+public:
+	mem_pool_configable()
+	{
+		for (size_t i = 0; i < mem_cell::PoolCount; ++i)
 		{
-			pools[_PoolIndex] = _pool_pointer_type(new mem_raw_pool(
-				_config::calc::cell_size_by_pool_index(_PoolIndex), 
-				_config::calc::cell_count_by_pool_index(_PoolIndex)));
-			_pool_creater<_PoolIndex - 1>::create(pools);
+			_pools[i].init(
+				_config::calc::cell_size_by_pool_index(i),
+				_config::calc::cell_count_by_pool_index(i));
 		}
-	};
-	template<>
-	struct _pool_creater<0> {
-		inline static void create(_pool_pointer_type pools[])
+	}
+
+public:
+	/// <summary>
+	/// fast path for one type: pool index and cell size are resolved at compile time,
+	/// only block refill and release go out of line
+	/// </summary>
+	template<typename _T>
+	class typed_pool {
+		using type_meta = typename _config::template type_meta<_T>;
+		static_assert(type_meta::pool_index < mem_cell::PoolCount, "pool_index is too large");
+
+		mem_raw_pool& _raw_pool;
+
+	public:
+		inline explicit typed_pool(mem_pool_configable& pool) : _raw_pool(pool._pools[type_meta::pool_index]) {}
+
+	public:
+		inline void* alloc()
+		{
+			auto user_mem = _raw_pool.template alloc<type_meta::cell_size>();
+			mem_cell::get_cell(user_mem).head = static_cast<mem_cell::head_type>(type_meta::pool_index);
+			return user_mem;
+		}
+		/// <summary>
+		/// user_mem must be returned from alloc() of the same type
+		/// </summary>
+		inline bool free(void* user_mem)
 		{
-			pools[0] = _pool_pointer_type(new mem_raw_pool(
-				_config::calc::cell_size_by_pool_index(0),
-				_config::calc::cell_count_by_pool_index(0)));
+			return _raw_pool.template free<type_meta::cell_size>(user_mem);
 		}
 	};
 
-public:
-	mem_pool_configable()
+	template<typename _T>
+	inline typed_pool<_T> get_typed_pool()
 	{
-		_pool_creater<mem_cell::PoolCount - 1>::create(_pools);
+		return typed_pool<_T>(*this);
 	}
 
 public:
 	template<typename _T>
 	inline void* alloc()
 	{
-		using type_meta = typename _config::template type_meta<_T>;
-		static_assert(type_meta::pool_index < mem_cell::PoolCount, "pool_index is too large");
-		auto user_mem = _pools[type_meta::pool_index]->alloc();
-		if (nullptr != user_mem)
-		{
-			mem_cell::get_cell(user_mem).head = static_cast<mem_cell::head_type>(type_meta::pool_index);
-		}
-		return user_mem;
+		return typed_pool<_T>(*this).alloc();
+	}
+	template<typename _T>
+	inline bool free(void* user_mem)
+	{
+		return typed_pool<_T>(*this).free(user_mem);
 	}
 	void* alloc(size_t user_mem_size);
+	/// <summary>
+	/// usable bytes of a cell of the pool at pool_index
+	/// </summary>
+	inline constexpr static size_t user_mem_size_of_pool(size_t pool_index)
+	{
+		return _config::calc::cell_size_by_pool_index(pool_index) - mem_cell::UserMemOffset;
+	}
+	/// <summary>
+	/// stays in place while user_mem_size maps to the same cell size, otherwise copies to a new cell.
+	/// on failure returns nullptr and user_mem is left untouched
+	/// </summary>
 	void* realloc(void* user_mem, size_t user_mem_size);
 	bool free(void* user_mem);
+	/// <summary>
+	/// frees cells of any pools, user_mems is sorted in place by pool and address so each block is visited once.
+	/// blocks emptied by the batch are released at once unless release_blocks is false. returns the number of released blocks
+	/// </summary>
+	size_t free_batch(void** user_mems, size_t count, bool release_blocks = true);
 
 #if ENABLE_MEM_POOL_CLEANUP
 	void cleanup_step();
 	bool* get_pool_mem_freed_ptr(void* user_mem);
+	/// <summary>
+	/// empties and releases one block that is at most max_occupancy_percent used, pools are visited round robin.
+	/// _Mover has bool can_move(void* user_mem) and void move(void* from, void* to); a block with a cell it cannot move is left alone.
+	/// returns whether a block was released
+	/// </summary>
+	template<typename _Mover>
+	bool compact_step(size_t max_occupancy_percent, _Mover& mover);
 #else
 	inline void cleanup_step() {}
 	inline bool* get_pool_mem_freed_ptr(void* user_mem) { return nullptr; }
@@ -123,7 +167,7 @@ void* mem_pool_configable<_CellUnitSize, _BlockMaxSize>::alloc(size_t user_mem_s
 	auto pool_index = _config::calc::pool_index(user_mem_size);
 	if (pool_index < mem_cell::PoolCount)
 	{
-		auto user_mem = _pools[pool_index]->alloc();
+		auto user_mem = _pools[pool_index].alloc();
 		if (nullptr != user_mem)
 		{
 			mem_cell::get_cell(user_mem).head = static_cast<mem_cell::head_type>(pool_index);
@@ -140,14 +184,26 @@ void* mem_pool_configable<_CellUnitSize, _BlockMaxSize>::alloc(size_t user_mem_s
 template<size_t _CellUnitSize, size_t _BlockMaxSize>
 void* mem_pool_configable<_CellUnitSize, _BlockMaxSize>::realloc(void* user_mem, size_t user_mem_size)
 {
+	if (nullptr == user_mem)
+	{
+		return alloc(user_mem_size);
+	}
 	auto old_pool_index = static_cast<size_t>(mem_cell::get_cell(user_mem).head);
 	auto new_pool_index = _config::calc::pool_index(user_mem_size);
 	if (old_pool_index == new_pool_index)
 	{
 		return user_mem;
 	}
-	free(user_mem);
-	return alloc(user_mem_size);
+
+	// the old cell must stay alive until its content is copied
+	auto new_user_mem = alloc(user_mem_size);
+	if (nullptr != new_user_mem)
+	{
+		auto old_user_mem_size = user_mem_size_of_pool(old_pool_index);
+		memcpy(new_user_mem, user_mem, old_user_mem_size < user_mem_size ? old_user_mem_size : user_mem_size);
+		free(user_mem);
+	}
+	return new_user_mem;
 }
 
 template<size_t _CellUnitSize, size_t _BlockMaxSize>
@@ -161,15 +217,43 @@ bool mem_pool_configable<_CellUnitSize, _BlockMaxSize>::free(void* user_mem)
 	return p_pool->free(user_mem);
 }
 
+template<size_t _CellUnitSize, size_t _BlockMaxSize>
+size_t mem_pool_configable<_CellUnitSize, _BlockMaxSize>::free_batch(void** user_mems, size_t count, bool release_blocks)
+{
+	std::sort(user_mems, user_mems + count, [](void* lhs, void* rhs)
+	{
+		auto lhs_head = mem_cell::get_cell(lhs).head;
+		auto rhs_head = mem_cell::get_cell(rhs).head;
+		return lhs_head != rhs_head ? lhs_head < rhs_head : lhs < rhs;
+	});
+
+	size_t released_count = 0;
+	size_t beg = 0;
+	while (beg < count)
+	{
+		auto head = mem_cell::get_cell(user_mems[beg]).head;
+		auto end = beg + 1;
+		while (end < count && head == mem_cell::get_cell(user_mems[end]).head)
+		{
+			++end;
+		}
+		auto p_pool = _get_pool(user_mems[beg]);
+		if (nullptr != p_pool)
+		{
+			released_count += p_pool->free_sorted(user_mems + beg, end - beg, release_blocks);
+		}
+		beg = end;
+	}
+	return released_count;
+}
+
 #if ENABLE_MEM_POOL_CLEANUP
 template<size_t _CellUnitSize, size_t _BlockMaxSize>
 void mem_pool_configable<_CellUnitSize, _BlockMaxSize>::cleanup_step()
 {
-	mem_raw_pool* p_pool = nullptr;
 	for (size_t i = _cleanup_index; mem_cell::PoolCount > i; ++i)
 	{
-		p_pool = _pools[i].get();
-		if (nullptr != p_pool && 0 < p_pool->cleanup_free_blocks())
+		if (0 < _pools[i].cleanup_free_blocks())
 		{
 			_cleanup_index = i + 1;
 			if (mem_cell::PoolCount == _cleanup_index)
@@ -182,7 +266,7 @@ void mem_pool_configable<_CellUnitSize, _BlockMaxSize>::cleanup_step()
 
 	for (size_t i = 0; i < _cleanup_index; ++i)
 	{
-		if (nullptr != p_pool && 0 < p_pool->cleanup_free_blocks())
+		if (0 < _pools[i].cleanup_free_blocks())
 		{
 			_cleanup_index = i + 1;
 			return;
@@ -190,6 +274,35 @@ void mem_pool_configable<_CellUnitSize, _BlockMaxSize>::cleanup_step()
 	}
 }
 template<size_t _CellUnitSize, size_t _BlockMaxSize>
+template<typename _Mover>
+bool mem_pool_configable<_CellUnitSize, _BlockMaxSize>::compact_step(size_t max_occupancy_percent, _Mover& mover)
+{
+	for (size_t n = 0; n < mem_cell::PoolCount; ++n)
+	{
+		auto pool_index = _compact_index;
+		_compact_index = mem_cell::PoolCount == _compact_index + 1 ? 0 : _compact_index + 1;
+
+		auto& raw_pool = _pools[pool_index];
+		auto max_used_count = _config::calc::cell_count_by_pool_index(pool_index) * max_occupancy_percent / 100;
+		auto block = raw_pool.find_sparse_block(max_used_count, [&mover](void* user_mem) { return mover.can_move(user_mem); });
+		if (nullptr == block)
+		{
+			continue;
+		}
+
+		raw_pool.begin_evacuate(block);
+		raw_pool.for_each_used_cell(block, [&](void* user_mem)
+		{
+			auto new_user_mem = raw_pool.alloc();
+			mem_cell::get_cell(new_user_mem).head = static_cast<mem_cell::head_type>(pool_index);
+			mover.move(user_mem, new_user_mem);
+			raw_pool.abandon_cell(user_mem);
+		});
+		return raw_pool.end_evacuate(block);
+	}
+	return false;
+}
+template<size_t _CellUnitSize, size_t _BlockMaxSize>
 bool* mem_pool_configable<_CellUnitSize, _BlockMaxSize>::get_pool_mem_freed_ptr(void* user_mem)
 {
 	auto p_pool = _get_pool(user_mem);
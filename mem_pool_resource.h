@@ -0,0 +1,96 @@
+
+#ifndef MEM_POOL_RESOURCE_H
+#define MEM_POOL_RESOURCE_H
+
+#include "core.h"
+#include "mem_cell.h"
+#include "mem_pool.h"
+#include "frame_arena.h"
+#include <memory_resource>
+
+CORE_NAMESPACE_BEG
+
+/// <summary>
+/// std::pmr adapter over one mem_pool_configable instance, so pmr containers can be bound to a pool at runtime.
+/// requests the pool can't serve (too large, or over-aligned) go to the upstream resource
+/// </summary>
+template<typename _M>
+class pool_memory_resource final : public std::pmr::memory_resource {
+	_M& _pool;
+	std::pmr::memory_resource* _upstream;
+
+public:
+	static const size_t PoolAlign = alignof(mem_cell::align_type);
+
+	explicit pool_memory_resource(_M& pool, std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+		: _pool(pool)
+		, _upstream(upstream)
+	{
+	}
+
+public:
+	inline _M& get_pool() const { return _pool; }
+	inline std::pmr::memory_resource* get_upstream() const { return _upstream; }
+
+private:
+	inline static bool _served_by_pool(size_t bytes, size_t alignment)
+	{
+		return PoolAlign >= alignment && _M::info_for_global::max_cell_user_mem_size >= bytes;
+	}
+
+protected:
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		if (_served_by_pool(bytes, alignment))
+		{
+			return _pool.alloc(bytes);
+		}
+		return _upstream->allocate(bytes, alignment);
+	}
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override
+	{
+		if (_served_by_pool(bytes, alignment))
+		{
+			_pool.free(p);
+			return;
+		}
+		_upstream->deallocate(p, bytes, alignment);
+	}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+using mem_pool_resource = pool_memory_resource<mem_pool>;
+using large_mem_pool_resource = pool_memory_resource<large_mem_pool>;
+
+/// <summary>
+/// monotonic std::pmr adapter over a frame_arena: deallocate does nothing, memory comes back on arena reset or rewind
+/// </summary>
+class frame_arena_resource final : public std::pmr::memory_resource {
+	frame_arena& _arena;
+
+public:
+	explicit frame_arena_resource(frame_arena& arena) : _arena(arena) {}
+
+public:
+	inline frame_arena& get_arena() const { return _arena; }
+
+protected:
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		return _arena.alloc(bytes, alignment);
+	}
+	void do_deallocate(void*, size_t, size_t) override
+	{
+	}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+CORE_NAMESPACE_END
+
+#endif
@@ -2,11 +2,8 @@
 #include "mem_cell.h"
 #include "environment.h"
 #include "bug_reporter.h"
-#include <string.h>
-
-// ಢûжֶνйʼڴԶ
-// ƻᵼ·ĸֶγʼֵӦȥ֤ԼڴĿ
-#define CLEAN_MEM 1
+#include <algorithm>
+#include <atomic>
 
 CORE_NAMESPACE_BEG
 
@@ -16,6 +13,12 @@ typedef void (*fp_mem_free_type)(void* mem);
 static fp_mem_alloc_type s_fp_mem_alloc = ::operator new;
 static fp_mem_free_type s_fp_mem_free = ::operator delete;
 
+#if CELL_GENERATION
+// seeds the cells of each new block, a block that comes back at a released block's address
+// does not restart its generations where temp refs into the old one may still sit
+static std::atomic<uint16_t> s_next_block_generation(0);
+#endif // CELL_GENERATION
+
 inline bool* _new_block_freed_state()
 {
 	return new bool(false);
@@ -47,23 +50,11 @@ mem_raw_pool::~mem_raw_pool()
 #endif // ENABLE_MEM_POOL_CLEANUP
 }
 
-void* mem_raw_pool::alloc()
-{
-	return (void*)_pop_cell().user_mem;
-}
-
-bool mem_raw_pool::free(void* user_mem)
+void mem_raw_pool::_report_free_failed()
 {
-	auto& c = mem_cell::get_cell(user_mem);
-	if (!c.is_used())
-	{
-		environment::get_current_env().get_bug_reporter().report(
-			BUG_TAG_MEM_RAW_POOL,
-			"mem_raw_pool free failed: user_mem is not return from alloc()!");
-		return false;
-	}
-	_push_cell(c);
-	return true;
+	environment::get_current_env().get_bug_reporter().report(
+		BUG_TAG_MEM_RAW_POOL,
+		"mem_raw_pool free failed: user_mem is not return from alloc()!");
 }
 
 
@@ -84,7 +75,7 @@ size_t mem_raw_pool::cleanup_free_blocks()
 			// 2.
 			s_fp_mem_free(block);
 			// 3.
-			_blocks.pop_back();
+			_blocks.erase(_blocks.begin() + i);
 #if ENABLE_MEM_POOL_CLEANUP
 			// 4.
 			_try_set_block_freed_state(block, true);
@@ -97,29 +88,25 @@ size_t mem_raw_pool::cleanup_free_blocks()
 }
 #endif // ENABLE_MEM_POOL_CLEANUP
 
-void mem_raw_pool::_push_cell(mem_cell& c)
+size_t mem_raw_pool::free_sorted(void* const* user_mems, size_t count, bool release_blocks)
 {
-	c.mark_unused();
-#if CLEAN_MEM
-	memset(c.user_mem, 0, _cell_size - mem_cell::UserMemOffset);
-#endif
-	c.p_next_cell = _free_head;
-	_free_head = &c;
-}
-mem_cell& mem_raw_pool::_pop_cell()
-{
-	if (nullptr == _free_head)
+	size_t released_count = 0;
+	// from the back, so the free link hands the cells out again in address order
+	size_t i = count;
+	while (0 < i)
 	{
-		_new_block();
+#if ENABLE_MEM_POOL_CLEANUP
+		if (release_blocks && _cell_count <= i && _try_release_used_block(user_mems + i - _cell_count))
+		{
+			i -= _cell_count;
+			++released_count;
+			continue;
+		}
+#endif // ENABLE_MEM_POOL_CLEANUP
+		--i;
+		_free(user_mems[i], _cell_size);
 	}
-
-	auto p_cell = _free_head;
-	_free_head = _free_head->p_next_cell;
-	p_cell->mark_used();
-#if CLEAN_MEM
-	memset(p_cell->user_mem, 0, _cell_size - mem_cell::UserMemOffset);
-#endif
-	return *p_cell;
+	return released_count;
 }
 
 void mem_raw_pool::_new_block()
@@ -132,14 +119,24 @@ void mem_raw_pool::_new_block()
 
 	// 3.
 	_blocks.push_back(block);
+#if ENABLE_MEM_POOL_CLEANUP
+	// 4. a released block may come back at the same address
+	_try_set_block_freed_state(block, false);
+#endif
 }
 
 void mem_raw_pool::_push_block_cells_into_free_link(void* block)
 {
 	mem_cell* p_cell = (mem_cell*)block;
+#if CELL_GENERATION
+	const uint16_t generation = s_next_block_generation.fetch_add(1, std::memory_order_relaxed);
+#endif // CELL_GENERATION
 	for (size_t i = 0; i < _cell_count; ++i)
 	{
-		_push_cell(*p_cell);
+#if CELL_GENERATION
+		mem_cell::store_generation(p_cell->generation(), generation);
+#endif // CELL_GENERATION
+		_push_cell(*p_cell, _cell_size);
 		p_cell = (mem_cell*)((intptr_t)p_cell + _cell_size);
 	}
 }
@@ -157,11 +154,93 @@ bool mem_raw_pool::_block_is_free(void* block)
 			// not free
 			return false;
 		}
-		p_cell = (mem_cell*)((intptr_t)block + _cell_size);
+		p_cell = (mem_cell*)((intptr_t)p_cell + _cell_size);
 	}
 	return true;
 }
 
+#if ENABLE_MEM_POOL_CLEANUP
+/// <summary>
+/// user_mems holds _cell_count sorted cells. when they are exactly the cells of one block and all in use,
+/// none of them is in the free link, so the block is released without touching the link
+/// </summary>
+bool mem_raw_pool::_try_release_used_block(void* const* user_mems)
+{
+	const auto block = (void*)&mem_cell::get_cell(user_mems[0]);
+	const auto last_cell = (intptr_t)&mem_cell::get_cell(user_mems[_cell_count - 1]);
+	if ((intptr_t)block + (intptr_t)(_cell_size * (_cell_count - 1)) != last_cell)
+	{
+		return false;
+	}
+	auto iter = std::find(_blocks.begin(), _blocks.end(), block);
+	if (_blocks.end() == iter)
+	{
+		return false;
+	}
+	for (size_t i = 0; i < _cell_count; ++i)
+	{
+		auto& c = mem_cell::get_cell(user_mems[i]);
+		if ((intptr_t)&c != (intptr_t)block + (intptr_t)(_cell_size * i) || !c.is_used())
+		{
+			return false;
+		}
+	}
+	_release_block(static_cast<size_t>(iter - _blocks.begin()));
+	return true;
+}
+
+bool mem_raw_pool::end_evacuate(void* block)
+{
+	auto iter = std::find(_blocks.begin(), _blocks.end(), block);
+	if (_blocks.end() == iter)
+	{
+		return false;
+	}
+	if (_block_is_free(block))
+	{
+		_release_block(static_cast<size_t>(iter - _blocks.begin()));
+		return true;
+	}
+	mem_cell* p_cell = (mem_cell*)block;
+	for (size_t i = 0; i < _cell_count; ++i)
+	{
+		if (!p_cell->is_used())
+		{
+			_push_cell(*p_cell, _cell_size);
+		}
+		p_cell = (mem_cell*)((intptr_t)p_cell + _cell_size);
+	}
+	return false;
+}
+
+size_t mem_raw_pool::_used_cell_count(void* block)
+{
+	size_t used_count = 0;
+	mem_cell* p_cell = (mem_cell*)block;
+	for (size_t i = 0; i < _cell_count; ++i)
+	{
+		if (p_cell->is_used())
+		{
+			++used_count;
+		}
+		p_cell = (mem_cell*)((intptr_t)p_cell + _cell_size);
+	}
+	return used_count;
+}
+
+/// <summary>
+/// the block must not have cells in the free link
+/// </summary>
+void mem_raw_pool::_release_block(size_t block_index)
+{
+	auto block = _blocks[block_index];
+	// the freed state is keyed by the block address, record it while the address is still ours
+	_try_set_block_freed_state(block, true);
+	_blocks.erase(_blocks.begin() + block_index);
+	s_fp_mem_free(block);
+}
+#endif // ENABLE_MEM_POOL_CLEANUP
+
 /// <summary>
 /// ˺ʱߣcellǰڵָ뽫бΪ˫бڵϿִЧ
 /// </summary>
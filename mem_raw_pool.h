@@ -4,12 +4,17 @@
 
 #include "core.h"
 #include "noncopyable.h"
+#include "mem_cell.h"
 #include <vector>
 #include <map>
+#include <string.h>
+
+// cells are zeroed on alloc and free because some classes rely on it instead of initializing every field.
+// that makes the pool slower, classes should initialize their own fields so this can be turned off
+#define MEM_RAW_POOL_CLEAN_MEM 1
 
 CORE_NAMESPACE_BEG
 
-struct mem_cell;
 class test_mem_pool;
 
 class mem_raw_pool : noncopyable {
@@ -23,6 +28,11 @@ class mem_raw_pool : noncopyable {
 	size_t _cell_count;
 
 public:
+	mem_raw_pool()
+		: mem_raw_pool(0, 0)
+	{
+
+	}
 	mem_raw_pool(size_t c_size, size_t c_count)
 		: _cell_size(c_size)
 		, _cell_count(c_count)
@@ -34,18 +44,114 @@ public:
 	~mem_raw_pool();
 
 public:
-	void* alloc();
-	bool free(void* user_mem);
+	/// <summary>
+	/// for pools constructed in place by default, must be called before the first alloc()
+	/// </summary>
+	inline void init(size_t c_size, size_t c_count)
+	{
+		_cell_size = c_size;
+		_cell_count = c_count;
+	}
+
+public:
+	inline void* alloc()
+	{
+		return (void*)_pop_cell(_cell_size).user_mem;
+	}
+	inline bool free(void* user_mem)
+	{
+		return _free(user_mem, _cell_size);
+	}
+
+	/// <summary>
+	/// _CellSize must be equal to the cell size of this pool, so cleaning the cell has a compile-time length
+	/// </summary>
+	template<size_t _CellSize>
+	inline void* alloc()
+	{
+		return (void*)_pop_cell(_CellSize).user_mem;
+	}
+	template<size_t _CellSize>
+	inline bool free(void* user_mem)
+	{
+		return _free(user_mem, _CellSize);
+	}
+
+	/// <summary>
+	/// frees user_mems sorted by ascending address, all from this pool.
+	/// a block whose every cell is in the batch is released at once instead of waiting for cleanup_free_blocks(),
+	/// unless release_blocks is false. returns the number of released blocks
+	/// </summary>
+	size_t free_sorted(void* const* user_mems, size_t count, bool release_blocks = true);
+
 #if ENABLE_MEM_POOL_CLEANUP
 	// NOTICE!! this function is expensive
 	size_t cleanup_free_blocks();
+
+public: // compaction, moves the used cells out of a sparse block so it can be released
+	/// <summary>
+	/// the block with the fewest used cells, between 1 and max_used_count, whose used cells all pass can_move(user_mem)
+	/// and fit into the free cells of the other blocks. nullptr if there is none. scans every cell
+	/// </summary>
+	template<typename _Pred>
+	void* find_sparse_block(size_t max_used_count, _Pred can_move);
+	/// <summary>
+	/// takes the free cells of block out of the free link, so alloc() fills the other blocks while its cells move out
+	/// </summary>
+	inline void begin_evacuate(void* block) { _pop_block_cells_from_free_link(block); }
+	/// <summary>
+	/// a cell of the evacuating block whose content moved, unused but kept out of the free link
+	/// </summary>
+	inline void abandon_cell(void* user_mem) { mem_cell::get_cell(user_mem).mark_unused(); }
+	/// <summary>
+	/// releases block if none of its cells is used any more, otherwise links its free cells again. returns whether it was released
+	/// </summary>
+	bool end_evacuate(void* block);
+	template<typename _F>
+	void for_each_used_cell(void* block, _F f);
 #else
 	inline constexpr size_t cleanup_free_blocks() { return 0; }
 #endif // ENABLE_MEM_POOL_CLEANUP
 
 private:
-	void _push_cell(mem_cell& c);
-	mem_cell& _pop_cell();
+	inline bool _free(void* user_mem, size_t c_size)
+	{
+		auto& c = mem_cell::get_cell(user_mem);
+		if (!c.is_used())
+		{
+			_report_free_failed();
+			return false;
+		}
+		_push_cell(c, c_size);
+		return true;
+	}
+	inline void _push_cell(mem_cell& c, size_t c_size)
+	{
+		c.mark_unused();
+#if MEM_RAW_POOL_CLEAN_MEM
+		memset(c.user_mem, 0, c_size - mem_cell::UserMemOffset);
+#endif
+		c.p_next_cell = _free_head;
+		_free_head = &c;
+	}
+	inline mem_cell& _pop_cell(size_t c_size)
+	{
+		if (nullptr == _free_head)
+		{
+			_new_block();
+		}
+
+		auto p_cell = _free_head;
+		_free_head = _free_head->p_next_cell;
+		p_cell->mark_used();
+#if MEM_RAW_POOL_CLEAN_MEM
+		memset(p_cell->user_mem, 0, c_size - mem_cell::UserMemOffset);
+#endif
+		return *p_cell;
+	}
+
+private: // slow path
+	void _report_free_failed();
 	void _new_block();
 	void _push_block_cells_into_free_link(void* block);
 	bool _block_is_free(void* block);
@@ -64,6 +170,9 @@ private:
 
 	bool* _get_block_freed_state(void* block);
 	bool _try_set_block_freed_state(void* block, bool state);
+	bool _try_release_used_block(void* const* user_mems);
+	size_t _used_cell_count(void* block);
+	void _release_block(size_t block_index);
 
 public:
 	bool* get_pool_mem_freed_ptr(void* user_mem);
@@ -73,6 +182,55 @@ public:
 #endif // ENABLE_MEM_POOL_CLEANUP
 };
 
+#if ENABLE_MEM_POOL_CLEANUP
+template<typename _Pred>
+void* mem_raw_pool::find_sparse_block(size_t max_used_count, _Pred can_move)
+{
+	if (2 > _blocks.size())
+	{
+		return nullptr;
+	}
+	size_t free_count = 0;
+	void* best_block = nullptr;
+	size_t best_used_count = max_used_count + 1;
+	for (auto block : _blocks)
+	{
+		auto used_count = _used_cell_count(block);
+		free_count += _cell_count - used_count;
+		if (0 < used_count && used_count < best_used_count)
+		{
+			bool movable = true;
+			for_each_used_cell(block, [&](void* user_mem) { movable = movable && can_move(user_mem); });
+			if (movable)
+			{
+				best_block = block;
+				best_used_count = used_count;
+			}
+		}
+	}
+	// the free cells of the chosen block do not count, they leave the free link while it empties
+	if (nullptr == best_block || free_count - (_cell_count - best_used_count) < best_used_count)
+	{
+		return nullptr;
+	}
+	return best_block;
+}
+
+template<typename _F>
+void mem_raw_pool::for_each_used_cell(void* block, _F f)
+{
+	mem_cell* p_cell = (mem_cell*)block;
+	for (size_t i = 0; i < _cell_count; ++i)
+	{
+		if (p_cell->is_used())
+		{
+			f((void*)p_cell->user_mem);
+		}
+		p_cell = (mem_cell*)((intptr_t)p_cell + _cell_size);
+	}
+}
+#endif // ENABLE_MEM_POOL_CLEANUP
+
 CORE_NAMESPACE_END
 
 #endif
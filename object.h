@@ -5,6 +5,7 @@
 #include "core.h"
 #include "noncopyable.h"
 #include "dis_new.h"
+#include "object_type_info.h"
 
 CORE_NAMESPACE_BEG
 
@@ -17,8 +18,20 @@ class object : noncopyable, dis_new {
 	//----------------------------------------<
 
     friend class object_factory;
+    friend class object_temp_ref_checker;
     void* _mem = nullptr; // used by object_factory
 
+public:
+    // the root of OBJECT_TYPE_INFO
+    typedef object _object_type_self;
+    static const size_t _object_type_depth = 0;
+    static const object_type_info& static_type_info()
+    {
+        static const object_type_info s_type_info(nullptr);
+        return s_type_info;
+    }
+    virtual const object_type_info& get_type_info() const { return static_type_info(); }
+
 protected:
     object() {};
     virtual ~object() {}
@@ -1,135 +1,122 @@
 
 #include "object_factory.h"
 #include "environment.h"
-#include <vector>
-
-#if ENABLE_REF_SAFE_CHECK
 #include "bug_reporter.h"
-#endif // REF_SAFE_CHECK
+#include <algorithm>
+#include <chrono>
+#include <string.h>
 
 CORE_NAMESPACE_BEG
 
-class temp_ref_mem_pool : noncopyable {
-	using _block_array_type = std::vector<void*>;
-	size_t _cell_size;
-	size_t _cell_count;
-	_block_array_type _blocks;
-	void* _free_mem;
-	size_t _next_block_index;
-	size_t _used_count_in_cur_block;
-
-public:
-	temp_ref_mem_pool(size_t cell_size, size_t cell_count)
-		: _cell_size(cell_size)
-		, _cell_count(cell_count)
-		, _blocks()
-		, _free_mem(nullptr)
-		, _next_block_index(0)
-		, _used_count_in_cur_block(0)
-	{
+// --------------------------------------------------
 
-	}
-	~temp_ref_mem_pool();
+bool object_factory::_shared_ref_deleter::delete_obj(support_shared_ref* p_obj)
+{
+	return environment::get_cur_object_factory().delete_obj(p_obj);
+}
 
-public:
-	void* alloc();
-	void reset();
+// --------------------------------------------------
 
-private:
-	void _new_block();
-	void* _pop_cell();
-};
+thread_local object_factory::_thread_context* object_factory::_s_p_cur_context = nullptr;
 
-temp_ref_mem_pool::~temp_ref_mem_pool()
+object_factory::_thread_context::_thread_context(object_factory& factory, size_t temp_ref_arena_block_size)
+	: p_factory(&factory)
+	, obj_mem_cache(factory._obj_mem_pool, factory._obj_mem_pool_mutex)
+	, temp_ref_arena(temp_ref_arena_block_size)
+	, delay_destroy_objs()
+	, in_use(false)
 {
-	for (auto block : _blocks)
-	{
-		::operator delete(block);
-	}
-	_blocks.clear();
-	_free_mem = nullptr;
-	_next_block_index = 0;
-	_used_count_in_cur_block = 0;
+
 }
 
-void* temp_ref_mem_pool::alloc()
+object_factory::thread_scope::thread_scope(object_factory& factory)
+	: _factory(factory)
+	, _p_context(nullptr)
+	, _p_prev_context(_s_p_cur_context)
 {
-	if (nullptr == _free_mem)
 	{
-		_new_block();
+		std::lock_guard<std::mutex> lock(factory._thread_contexts_mutex);
+		for (auto& p_context : factory._thread_contexts)
+		{
+			if (!p_context->in_use)
+			{
+				_p_context = p_context.get();
+				break;
+			}
+		}
+		if (nullptr == _p_context)
+		{
+			factory._thread_contexts.emplace_back(new _thread_context(factory, factory._temp_ref_arena_block_size));
+			_p_context = factory._thread_contexts.back().get();
+		}
+		_p_context->in_use = true;
 	}
-	return _pop_cell();
+	_s_p_cur_context = _p_context;
 }
-void temp_ref_mem_pool::reset()
+
+object_factory::thread_scope::~thread_scope()
 {
-	_free_mem = nullptr;
-	_next_block_index = 0;
-	_used_count_in_cur_block = 0;
+	_s_p_cur_context = _p_prev_context;
+	std::lock_guard<std::mutex> lock(_factory._thread_contexts_mutex);
+	_p_context->in_use = false;
 }
 
-void temp_ref_mem_pool::_new_block()
+// --------------------------------------------------
+
+object_factory::object_factory(size_t temp_ref_pool_cell_count, size_t frame_arena_block_size)
+	: _frame_arena(frame_arena_block_size)
+	, _temp_ref_arena_block_size(sizeof(object_temp_ref<object>) * temp_ref_pool_cell_count)
+	, _main_context(*this, _temp_ref_arena_block_size)
+	, _pending_destroy_index(0)
+	, _destroy_budget_count(0)
+	, _destroy_budget_micro_seconds(0)
+	, _relocatable_count(0)
 {
-	void* block = nullptr;
-	if (_blocks.size() > _next_block_index)
-	{
-		block = _blocks[_next_block_index];
-	}
-	else
+	if (nullptr == mem_pool_utils::p_mem_pool)
 	{
-		block = ::operator new(_cell_size * _cell_count);
-		_blocks.push_back(block);
+		mem_pool_utils::p_mem_pool = &_mem_pool;
 	}
-	++_next_block_index;
-
-	_free_mem = block;
-	_used_count_in_cur_block = 0;
 }
-void* temp_ref_mem_pool::_pop_cell()
+
+object_factory::~object_factory()
 {
-	void* mem = _free_mem;
-	if (_cell_count == ++_used_count_in_cur_block)
+	_flush_delay_destroy("~object_factory while a thread_scope is open");
+	_reset_temp_ref_arenas();
+	_frame_arena.reset();
+	if (&_mem_pool == mem_pool_utils::p_mem_pool)
 	{
-		_free_mem = nullptr;
+		mem_pool_utils::p_mem_pool = nullptr;
 	}
-	else
-	{
-		_free_mem = (void*)((intptr_t)_free_mem + _cell_size);
-	}
-	return mem;
 }
 
-// --------------------------------------------------
-
-bool object_factory::_shared_ref_deleter::delete_obj(support_shared_ref* p_obj)
+void object_factory::on_frame_end()
 {
-	return environment::get_cur_object_factory().delete_obj(p_obj);
+	_merge_thread_contexts("on_frame_end while a thread_scope is open");
+	_destroy_pending_objs(_destroy_budget_count, _destroy_budget_micro_seconds, true);
+	_reset_temp_ref_arenas();
+	_frame_arena.reset();
 }
 
-// --------------------------------------------------
-
-object_factory::object_factory(size_t temp_ref_pool_cell_count)
-	: _p_temp_ref_pool(new temp_ref_mem_pool(sizeof(object_temp_ref<object>), temp_ref_pool_cell_count))
+void object_factory::flush_delay_destroy()
 {
-	if (nullptr == mem_pool_utils::p_mem_pool)
-	{
-		mem_pool_utils::p_mem_pool = &_mem_pool;
-	}
+	_flush_delay_destroy("flush_delay_destroy while a thread_scope is open");
 }
 
-object_factory::~object_factory()
+void object_factory::_flush_delay_destroy(const char* open_scope_bug)
 {
-	_handle_delay_destroy();
-	_recyle_temp_refs();
+	do
+	{
+		_merge_thread_contexts(open_scope_bug);
+		// temp refs of this frame stay valid, so their cells keep their blocks until on_frame_end()
+		_destroy_pending_objs(0, 0, false);
+	} while (!_main_context.delay_destroy_objs.empty());
 }
 
-void object_factory::on_frame_end()
+void object_factory::cleanup_mem_step()
 {
-	_handle_delay_destroy();
-	_recyle_temp_refs();
-
-#if ENABLE_REF_SAFE_CHECK
-	object_temp_ref_destroyed_pointers::clear_destroyed_pointers();
-#endif // REF_SAFE_CHECK
+	_mem_pool.cleanup_step();
+	std::lock_guard<std::mutex> lock(_obj_mem_pool_mutex);
+	_obj_mem_pool.cleanup_step();
 }
 
 #if ENABLE_REF_SAFE_CHECK
@@ -140,6 +127,7 @@ void object_factory::extern_retain(object* p_obj)
 		environment::get_cur_bug_reporter().report(BUG_TAG_OBJECT_FACTORY, "extern_retain nullptr");
 		return;
 	}
+	std::lock_guard<std::mutex> lock(_extern_retained_objs_mutex);
 	_extern_retained_objs.insert(p_obj);
 }
 void object_factory::extern_release(object* p_obj)
@@ -149,52 +137,277 @@ void object_factory::extern_release(object* p_obj)
 		environment::get_cur_bug_reporter().report(BUG_TAG_OBJECT_FACTORY, "extern_release nullptr");
 		return;
 	}
+	std::lock_guard<std::mutex> lock(_extern_retained_objs_mutex);
 	_extern_retained_objs.erase(p_obj);
 }
 #endif // ENABLE_REF_SAFE_CHECK
 
-void object_factory::_handle_delay_destroy()
+void object_factory::_merge_thread_contexts(const char* open_scope_bug)
 {
-	static _object_array_type temp;
-	auto obj_count = _delay_destroy_objs.size();
-	if (0 < obj_count)
+	// the owner thread first, objects that workers destroy by cascade wait for the next frame like its own
+	_handle_delay_destroy(_main_context);
+
+	std::lock_guard<std::mutex> lock(_thread_contexts_mutex);
+	for (auto& p_context : _thread_contexts)
 	{
-		_delay_destroy_objs.swap(temp);
-		for (size_t i = 0; i < obj_count; ++i)
+		if (p_context->in_use)
 		{
-			_delete_obj_immediately(temp[i]);
+			environment::get_cur_bug_reporter().report(BUG_TAG_OBJECT_FACTORY, open_scope_bug);
+			continue;
 		}
-		temp.clear();
+		_handle_delay_destroy(*p_context);
 	}
 }
 
-void* object_factory::_alloc_temp_ref_mem()
+void object_factory::_reset_temp_ref_arenas()
 {
-	return _p_temp_ref_pool->alloc();
+	_main_context.temp_ref_arena.reset();
+
+	std::lock_guard<std::mutex> lock(_thread_contexts_mutex);
+	for (auto& p_context : _thread_contexts)
+	{
+		if (!p_context->in_use)
+		{
+			p_context->temp_ref_arena.reset();
+		}
+	}
+}
+
+void object_factory::_handle_delay_destroy(_thread_context& context)
+{
+	auto& objs = context.delay_destroy_objs;
+	if (objs.empty())
+	{
+		return;
+	}
+	auto& pending_objs = _pending_destroy_objs;
+	if (0 < _pending_destroy_index)
+	{
+		pending_objs.erase(pending_objs.begin(), pending_objs.begin() + _pending_destroy_index);
+		_pending_destroy_index = 0;
+	}
+
+	// pool then address order: destructors walk memory forward and the batch free visits each block once
+	auto destroy_order = [](object* lhs, object* rhs)
+	{
+		auto lhs_head = mem_cell::get_cell(lhs->_mem).head;
+		auto rhs_head = mem_cell::get_cell(rhs->_mem).head;
+		return lhs_head != rhs_head ? lhs_head < rhs_head : lhs->_mem < rhs->_mem;
+	};
+	auto sorted_count = pending_objs.size();
+	pending_objs.insert(pending_objs.end(), objs.begin(), objs.end());
+	objs.clear();
+	std::sort(pending_objs.begin() + sorted_count, pending_objs.end(), destroy_order);
+	std::inplace_merge(pending_objs.begin(), pending_objs.begin() + sorted_count, pending_objs.end(), destroy_order);
+}
+
+void object_factory::_destroy_pending_objs(size_t max_count, size_t max_micro_seconds, bool release_blocks)
+{
+	// the time budget is checked between chunks, clock reads stay off the per object path
+	const size_t ChunkCount = 256;
+
+	auto beg = _pending_destroy_index;
+	auto end = _pending_destroy_objs.size();
+	if (0 < max_count && beg + max_count < end)
+	{
+		end = beg + max_count;
+	}
+	if (0 == max_micro_seconds)
+	{
+		_destroy_objs(_pending_destroy_objs.data() + beg, end - beg, release_blocks);
+		beg = end;
+	}
+	else
+	{
+		auto start_time = std::chrono::steady_clock::now();
+		auto max_duration = std::chrono::microseconds(max_micro_seconds);
+		while (beg < end)
+		{
+			auto chunk_end = beg + ChunkCount < end ? beg + ChunkCount : end;
+			_destroy_objs(_pending_destroy_objs.data() + beg, chunk_end - beg, release_blocks);
+			beg = chunk_end;
+			if (max_duration <= std::chrono::steady_clock::now() - start_time)
+			{
+				break;
+			}
+		}
+	}
+
+	if (_pending_destroy_objs.size() == beg)
+	{
+		_pending_destroy_objs.clear();
+		beg = 0;
+	}
+	_pending_destroy_index = beg;
 }
 
-void object_factory::_recyle_temp_refs()
+void object_factory::_destroy_objs(object* const* objs, size_t count, bool release_blocks)
 {
-	_p_temp_ref_pool->reset();
+	if (0 == count)
+	{
+		return;
+	}
+
+#if ENABLE_REF_SAFE_CHECK
+	{
+		std::lock_guard<std::mutex> lock(_extern_retained_objs_mutex);
+		if (!_extern_retained_objs.empty())
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (_extern_retained_objs.end() != _extern_retained_objs.find(objs[i]))
+				{
+					environment::get_cur_bug_reporter().report(BUG_TAG_OBJECT_FACTORY, "delete_obj still be retained by extern environment");
+				}
+			}
+		}
+	}
+#endif // REF_SAFE_CHECK
+
+	// destructors that delete by cascade push into the owner context, those objects wait for the next merge
+	auto& mems = _destroying_mems;
+	for (size_t i = 0; i < count; ++i)
+	{
+		auto p_obj = objs[i];
+		mems.push_back(p_obj->_mem);
+		_invalidate_temp_refs(p_obj->_mem);
+		p_obj->~object();
+	}
+	{
+		std::lock_guard<std::mutex> lock(_obj_mem_pool_mutex);
+		_obj_mem_pool.free_batch(mems.data(), mems.size(), release_blocks);
+	}
+	mems.clear();
 }
 
 void object_factory::_delete_obj(object* p_obj)
 {
-	_delay_destroy_objs.push_back(p_obj);
+	// compact_step() must not move it while it waits, the pending list and the destroy order hold its address
+	_remove_relocatables(&p_obj, 1);
+	// weak refs go null now, not when a later frame gets to the destructor
+	_release_weak_handle(cast_utils<object, support_weak_ref>::cast(p_obj));
+	_cur_context().delay_destroy_objs.push_back(p_obj);
 }
 
 void object_factory::_delete_obj_immediately(object* p_obj)
 {
 #if ENABLE_REF_SAFE_CHECK
-	object_temp_ref_destroyed_pointers::add_destroyed_pointer(p_obj);
-	if (_extern_retained_objs.end() != _extern_retained_objs.find(p_obj))
 	{
-		environment::get_cur_bug_reporter().report(BUG_TAG_OBJECT_FACTORY, "delete_obj still be retained by extern environment");
+		std::lock_guard<std::mutex> lock(_extern_retained_objs_mutex);
+		if (_extern_retained_objs.end() != _extern_retained_objs.find(p_obj))
+		{
+			environment::get_cur_bug_reporter().report(BUG_TAG_OBJECT_FACTORY, "delete_obj still be retained by extern environment");
+		}
 	}
 #endif // REF_SAFE_CHECK
+	_remove_relocatables(&p_obj, 1);
 	auto user_mem = p_obj->_mem;
+	_invalidate_temp_refs(user_mem);
 	p_obj->~object();
-	_mem_pool.free(user_mem);
+	_cur_context().obj_mem_cache.free(user_mem);
+}
+
+#if ENABLE_MEM_POOL_CLEANUP
+bool object_factory::compact_step(size_t max_occupancy_percent)
+{
+	if (0 == _relocatable_count.load(std::memory_order_relaxed))
+	{
+		return false;
+	}
+	// cached cells count as used, they would pin their blocks
+	_flush_obj_mem_caches();
+
+	struct _relocator {
+		object_factory& factory;
+
+		inline bool can_move(void* user_mem) const
+		{
+			auto iter = factory._relocatable_objs.find(user_mem);
+			if (factory._relocatable_objs.end() == iter)
+			{
+				return false;
+			}
+			auto p_relocate_obj = (support_relocate*)((intptr_t)user_mem + iter->second.relocate_offset);
+			return 0 == p_relocate_obj->_pin_count;
+		}
+		inline void move(void* from, void* to) const
+		{
+			factory._relocate_obj(from, to);
+		}
+	};
+	_relocator relocator{ *this };
+	std::lock_guard<std::mutex> lock(_relocatable_objs_mutex);
+	std::lock_guard<std::mutex> pool_lock(_obj_mem_pool_mutex);
+	return _obj_mem_pool.compact_step(max_occupancy_percent, relocator);
+}
+#else
+bool object_factory::compact_step(size_t)
+{
+	// blocks are never released without ENABLE_MEM_POOL_CLEANUP
+	return false;
+}
+#endif // ENABLE_MEM_POOL_CLEANUP
+
+void object_factory::_add_relocatable(void* user_mem, const _relocate_info& info)
+{
+	std::lock_guard<std::mutex> lock(_relocatable_objs_mutex);
+	_relocatable_objs[user_mem] = info;
+	_relocatable_count.store(_relocatable_objs.size(), std::memory_order_relaxed);
+}
+
+void object_factory::_remove_relocatables(object* const* objs, size_t count)
+{
+	if (0 == _relocatable_count.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+	std::lock_guard<std::mutex> lock(_relocatable_objs_mutex);
+	for (size_t i = 0; i < count; ++i)
+	{
+		_relocatable_objs.erase(objs[i]->_mem);
+	}
+	_relocatable_count.store(_relocatable_objs.size(), std::memory_order_relaxed);
+}
+
+void object_factory::_relocate_obj(void* from_user_mem, void* to_user_mem)
+{
+	auto iter = _relocatable_objs.find(from_user_mem);
+	auto info = iter->second;
+	_relocatable_objs.erase(iter);
+	_relocatable_objs[to_user_mem] = info;
+
+	memcpy(to_user_mem, from_user_mem, mem_pool::user_mem_size_of_pool(mem_cell::get_cell(from_user_mem).head));
+	auto p_obj = (object*)((intptr_t)to_user_mem + info.obj_offset);
+	p_obj->_mem = to_user_mem;
+	auto p_weak_obj = (support_weak_ref*)((intptr_t)to_user_mem + info.weak_offset);
+	object_handle_table::rebind(p_weak_obj->_handle, p_weak_obj);
+
+#if ENABLE_REF_SAFE_CHECK
+	{
+		auto p_old_obj = (object*)((intptr_t)from_user_mem + info.obj_offset);
+		std::lock_guard<std::mutex> lock(_extern_retained_objs_mutex);
+		if (0 < _extern_retained_objs.erase(p_old_obj))
+		{
+			_extern_retained_objs.insert(p_obj);
+		}
+	}
+#endif // REF_SAFE_CHECK
+
+	auto p_relocate_obj = (support_relocate*)((intptr_t)to_user_mem + info.relocate_offset);
+	p_relocate_obj->on_relocated((const support_relocate*)((intptr_t)from_user_mem + info.relocate_offset));
+}
+
+void object_factory::_flush_obj_mem_caches()
+{
+	_main_context.obj_mem_cache.flush();
+	std::lock_guard<std::mutex> lock(_thread_contexts_mutex);
+	for (auto& p_context : _thread_contexts)
+	{
+		if (!p_context->in_use)
+		{
+			p_context->obj_mem_cache.flush();
+		}
+	}
 }
 
 CORE_NAMESPACE_END
\ No newline at end of file
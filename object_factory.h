@@ -6,24 +6,28 @@
 #include "utils.h"
 #include "noncopyable.h"
 #include "mem_pool.h"
+#include "mem_pool_cache.h"
+#include "frame_arena.h"
 #include "object.h"
 #include "object_weak_ref.h"
 #include "object_temp_ref.h"
 #include "object_shared_ref.h"
+#include "object_relocate.h"
 #include "sfinae_macros.h"
 #include <type_traits>
 #include <vector>
-#include <memory>
 #include <utility>
 #include <initializer_list>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include <mutex>
 #if ENABLE_REF_SAFE_CHECK
 #include <set>
 #endif // ENABLE_REF_SAFE_CHECK
 
 CORE_NAMESPACE_BEG
 
-class temp_ref_mem_pool;
-
 template<typename _TID, typename _TObj>
 class object_manager;
 
@@ -35,28 +39,119 @@ class object_monitor_ptr;
 
 class object_factory final : noncopyable {
 	using _object_array_type = std::vector<object*>;
-	using _temp_ref_mem_pool_pointer_type = std::unique_ptr<temp_ref_mem_pool>;
 
-	mem_pool _mem_pool;
-	_temp_ref_mem_pool_pointer_type _p_temp_ref_pool;
+	// what one thread needs to create and destroy objects without locking, merged by on_frame_end()
+	struct _thread_context : noncopyable {
+		object_factory* p_factory;
+		mem_pool_cache obj_mem_cache;
+		frame_arena temp_ref_arena;
+		_object_array_type delay_destroy_objs;
+		bool in_use;
 
-	support_weak_ref::_id_type _next_object_id = support_weak_ref::_FIRST_ID;
-	_object_array_type _delay_destroy_objs;
+		_thread_context(object_factory& factory, size_t temp_ref_arena_block_size);
+	};
+	using _thread_context_array_type = std::vector<std::unique_ptr<_thread_context>>;
+
+	mem_pool _mem_pool;
+	// objects get a pool of their own, threads only reach it in batches through their context cache
+	mem_pool _obj_mem_pool;
+	std::mutex _obj_mem_pool_mutex;
+	frame_arena _frame_arena;
+
+	size_t _temp_ref_arena_block_size;
+	_thread_context _main_context;
+	std::mutex _thread_contexts_mutex;
+	_thread_context_array_type _thread_contexts;
+	// delayed objects merged from all contexts, sorted by pool and address from _pending_destroy_index on. owner thread only
+	_object_array_type _pending_destroy_objs;
+	size_t _pending_destroy_index;
+	std::vector<void*> _destroying_mems;
+	size_t _destroy_budget_count;
+	size_t _destroy_budget_micro_seconds;
+
+	// where the bases of a support_relocate object sit in its cell
+	struct _relocate_info {
+		intptr_t obj_offset;
+		intptr_t weak_offset;
+		intptr_t relocate_offset;
+	};
+	using _relocate_info_map_type = std::unordered_map<void*, _relocate_info>;
+	// support_relocate objects by user_mem, workers create them too
+	_relocate_info_map_type _relocatable_objs;
+	std::mutex _relocatable_objs_mutex;
+	std::atomic<size_t> _relocatable_count;
+
+	static thread_local _thread_context* _s_p_cur_context;
+	// new_objs() takes cells and handles this many at a time
+	static const size_t _NewObjsChunkCount = 64;
 
 public:
 	static const size_t DefaultTempRefPoolCellCount = 1000;
-	explicit object_factory(size_t temp_ref_pool_cell_count = DefaultTempRefPoolCellCount);
+	static const size_t DefaultFrameArenaBlockSize = 64 * 1024;
+	static const size_t DefaultCompactOccupancyPercent = 25;
+	explicit object_factory(
+		size_t temp_ref_pool_cell_count = DefaultTempRefPoolCellCount, 
+		size_t frame_arena_block_size = DefaultFrameArenaBlockSize);
 	~object_factory();
 
+public:
+	/// <summary>
+	/// lets a worker thread create and destroy objects and take temp refs until the scope ends, through a context of its own
+	/// (pool cache, temp ref arena, delay destroy list). the owner thread needs no scope.
+	/// on_frame_end() merges the contexts, call it only while no scope is open.
+	/// get_frame_arena() and the pool behind mem_pool_utils stay owner thread only
+	/// </summary>
+	class thread_scope final : noncopyable {
+		object_factory& _factory;
+		_thread_context* _p_context;
+		_thread_context* _p_prev_context;
+
+	public:
+		explicit thread_scope(object_factory& factory);
+		~thread_scope();
+	};
+
 public:
 	void on_frame_end();
-	inline void cleanup_mem_step() { _mem_pool.cleanup_step(); }
+	void cleanup_mem_step();
+
+	/// <summary>
+	/// caps the delayed destruction done by one on_frame_end(), in objects and/or microseconds, 0 means no limit.
+	/// the rest waits for later frames, already out of their managers and unreachable through weak refs
+	/// </summary>
+	inline void set_destroy_budget(size_t max_obj_count, size_t max_micro_seconds = 0)
+	{
+		_destroy_budget_count = max_obj_count;
+		_destroy_budget_micro_seconds = max_micro_seconds;
+	}
+	/// <summary>
+	/// destroys every delayed object now regardless of the budget, objects deleted by their destructors included.
+	/// owner thread only, while no thread_scope is open. temp refs taken this frame stay usable, the destroyed ones report as stale
+	/// </summary>
+	void flush_delay_destroy();
+	/// <summary>
+	/// delayed objects carried over from earlier frames
+	/// </summary>
+	inline size_t get_pending_destroy_count() const { return _pending_destroy_objs.size() - _pending_destroy_index; }
+
+	/// <summary>
+	/// moves the support_relocate objects out of one object pool block that is at most max_occupancy_percent used and frees the block.
+	/// a block holding any other object, a pinned one or a delay deleted one stays. always false without ENABLE_MEM_POOL_CLEANUP. call between frames on the owner thread while no thread_scope is open,
+	/// temp refs must not outlive the frame. returns whether a block was released
+	/// </summary>
+	bool compact_step(size_t max_occupancy_percent = DefaultCompactOccupancyPercent);
+
+	/// <summary>
+	/// scratch memory for the current frame, dropped in on_frame_end()
+	/// </summary>
+	inline frame_arena& get_frame_arena() { return _frame_arena; }
 
 
 #if ENABLE_REF_SAFE_CHECK
 private:
 	using _object_set_type = std::set<object*>;
 	_object_set_type _extern_retained_objs;
+	std::mutex _extern_retained_objs_mutex;
 public:
 	void extern_retain(object* p_obj);
 	void extern_release(object* p_obj);
@@ -67,24 +162,81 @@ public:
 #endif // ENABLE_REF_SAFE_CHECK
 
 private: // private functions
-	void _handle_delay_destroy();
-	void* _alloc_temp_ref_mem();
-	void _recyle_temp_refs();
-	template<typename _T, enable_if_convertible_int<_T, support_weak_ref> = 0>
+	inline _thread_context& _cur_context()
+	{
+		auto p_context = _s_p_cur_context;
+		return nullptr != p_context && this == p_context->p_factory ? *p_context : _main_context;
+	}
+	// open_scope_bug names the caller in the report for a scope still open
+	void _flush_delay_destroy(const char* open_scope_bug);
+	void _merge_thread_contexts(const char* open_scope_bug);
+	// temp refs live until the frame ends, not until the next merge
+	void _reset_temp_ref_arenas();
+	void _handle_delay_destroy(_thread_context& context);
+	void _destroy_pending_objs(size_t max_count, size_t max_micro_seconds, bool release_blocks);
+	void _destroy_objs(object* const* objs, size_t count, bool release_blocks);
+	// temp refs taken before see the bumped cell generation
+	inline static void _invalidate_temp_refs(void* user_mem)
+	{
+#if CELL_GENERATION
+		mem_cell::bump_generation(mem_cell::get_cell(user_mem).generation());
+#endif // CELL_GENERATION
+	}
+	inline void* _alloc_temp_ref_mem()
+	{
+		return _cur_context().temp_ref_arena.alloc(sizeof(object_temp_ref<object>), alignof(object_temp_ref<object>));
+	}
+	template<typename _T, enable_if_convertible_int<_T*, support_weak_ref*> = 0>
 	inline void _init_obj(_T* p, void* user_mem)
 	{
 		auto p_weak_obj = static_cast<support_weak_ref*>(p);
-		p_weak_obj->_instance_id = _next_object_id++;
+		p_weak_obj->_handle = object_handle_table::acquire(p_weak_obj);
 
 		auto p_obj = static_cast<object*>(p);
 		p_obj->_mem = user_mem;
 	}
-	template<typename _T, enable_if_not_convertible_int<_T, support_weak_ref> = 0>
+	template<typename _T, enable_if_not_convertible_int<_T*, support_weak_ref*> = 0>
 	inline void _init_obj(_T* p, void* user_mem)
 	{
 		auto p_obj = static_cast<object*>(p);
 		p_obj->_mem = user_mem;
 	}
+	template<typename _T, enable_if_convertible_int<_T*, support_weak_ref*> = 0>
+	inline void _init_obj_handles(_T* const* objs, size_t count)
+	{
+		object_handle_table::batch_acquirer acquirer;
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto p_weak_obj = static_cast<support_weak_ref*>(objs[i]);
+			p_weak_obj->_handle = acquirer.acquire(p_weak_obj);
+		}
+	}
+	template<typename _T, enable_if_not_convertible_int<_T*, support_weak_ref*> = 0>
+	inline void _init_obj_handles(_T* const*, size_t) {}
+	inline static void _release_weak_handle(support_weak_ref* p_weak_obj)
+	{
+		if (nullptr != p_weak_obj)
+		{
+			object_handle_table::release(p_weak_obj->_handle);
+			p_weak_obj->_handle = object_handle_table::InvalidHandle;
+		}
+	}
+	template<typename _T, enable_if_convertible_int<_T*, support_relocate*> = 0>
+	inline void _init_relocate(_T* p, void* user_mem)
+	{
+		static_assert(std::is_base_of<support_weak_ref, _T>::value, "support_relocate objects must support_weak_ref too");
+		_relocate_info info;
+		info.obj_offset = (intptr_t)static_cast<object*>(p) - (intptr_t)user_mem;
+		info.weak_offset = (intptr_t)static_cast<support_weak_ref*>(p) - (intptr_t)user_mem;
+		info.relocate_offset = (intptr_t)static_cast<support_relocate*>(p) - (intptr_t)user_mem;
+		_add_relocatable(user_mem, info);
+	}
+	template<typename _T, enable_if_not_convertible_int<_T*, support_relocate*> = 0>
+	inline void _init_relocate(_T*, void*) {}
+	void _add_relocatable(void* user_mem, const _relocate_info& info);
+	void _remove_relocatables(object* const* objs, size_t count);
+	void _relocate_obj(void* from_user_mem, void* to_user_mem);
+	void _flush_obj_mem_caches();
 	void _delete_obj(object* p_obj);
 	void _delete_obj_immediately(object* p_obj);
 
@@ -102,6 +254,8 @@ private: // friend functions
 	template<typename _T>
 	friend class object_monitor_ptr;
 
+	friend class test_object_factory;
+
 	struct _shared_ref_deleter { static bool delete_obj(support_shared_ref* p_obj); };
 	template<typename _T>
 	using object_shared_ref = object_shared_ref<_T, _shared_ref_deleter>;
@@ -110,6 +264,26 @@ private: // friend functions
 	_T* new_obj(_Args&&... args);
 	template<typename _T, typename _E>
 	_T* new_obj(std::initializer_list<_E> list);
+	/// <summary>
+	/// count objects of _T(args...) into objs, their cells taken from the cache and the pool in one go.
+	/// returns how many were created, fewer only when the pool runs out. when a constructor throws,
+	/// the objects created so far are destroyed, their cells freed, and the exception passes on
+	/// </summary>
+	template<typename _T, typename ..._Args>
+	inline size_t new_objs(_T** objs, size_t count, const _Args&... args)
+	{
+		return _new_objs(objs, count, [&](void* user_mem, size_t) { return new(user_mem) _T(args...); });
+	}
+	/// <summary>
+	/// new_objs() with _T(ids[i], args...) for the i-th object
+	/// </summary>
+	template<typename _T, typename _TID, typename ..._Args>
+	inline size_t new_objs_with_ids(_T** objs, const _TID* ids, size_t count, const _Args&... args)
+	{
+		return _new_objs(objs, count, [&](void* user_mem, size_t i) { return new(user_mem) _T(ids[i], args...); });
+	}
+	template<typename _T, typename _Construct>
+	size_t _new_objs(_T** objs, size_t count, _Construct construct);
 	template<typename _T>
 	inline bool delete_obj(_T* p)
 	{
@@ -133,41 +307,18 @@ private: // friend functions
 		return true;
 	}
 
-#if ENABLE_MEM_POOL_CLEANUP
-	template<typename _T>
-	inline object_weak_ref<_T> get_weak_ref(_T* p)
-	{
-		static_assert(std::is_base_of<object, _T>::value, "_T must be inherit from object");
-		if (nullptr == p)
-		{
-			return object_weak_ref<_T>(p);
-		}
-		return object_weak_ref<_T>(p, _mem_pool.get_pool_mem_freed_ptr(cast_utils<_T, object>::cast(p)->_mem));
-	}
-	template<typename _T>
-	inline object_weak_ref<_T> get_weak_ref(const ref<_T>& obj_ref)
-	{
-		static_assert(std::is_base_of<object, _T>::value, "_T must be inherit from object");
-		if (nullptr == obj_ref)
-		{
-			return object_weak_ref<_T>(obj_ref);
-		}
-		return object_weak_ref<_T>(obj_ref, _mem_pool.get_pool_mem_freed_ptr(cast_utils<_T, object>::cast(obj_ref.operator->())->_mem));
-	}
-#else
 	template<typename _T>
 	inline object_weak_ref<_T> get_weak_ref(_T* p)
 	{
 		static_assert(std::is_base_of<object, _T>::value, "_T must be inherit from object");
 		return object_weak_ref<_T>(p);
 	}
-	template<typename _T>
-	inline object_weak_ref<_T> get_weak_ref(const ref<_T>& obj_ref)
+	template<typename _T, typename _C>
+	inline object_weak_ref<_T> get_weak_ref(const ref<_T, _C>& obj_ref)
 	{
 		static_assert(std::is_base_of<object, _T>::value, "_T must be inherit from object");
 		return object_weak_ref<_T>(obj_ref);
 	}
-#endif // ENABLE_MEM_POOL_CLEANUP
 
 	template<typename _T>
 	inline object_temp_ref<_T>& get_temp_ref(_T* p_obj)
@@ -175,8 +326,8 @@ private: // friend functions
 		static_assert(std::is_base_of<object, _T>::value, "_T must be inherit from object");
 		return *new(_alloc_temp_ref_mem()) object_temp_ref<_T>(p_obj);
 	}
-	template<typename _T>
-	inline object_temp_ref<_T>& get_temp_ref(const ref<_T>& obj_ref)
+	template<typename _T, typename _C>
+	inline object_temp_ref<_T>& get_temp_ref(const ref<_T, _C>& obj_ref)
 	{
 		static_assert(std::is_base_of<object, _T>::value, "_T must be inherit from object");
 		return *new(_alloc_temp_ref_mem()) object_temp_ref<_T>(obj_ref);
@@ -188,8 +339,8 @@ private: // friend functions
 		static_assert(std::is_base_of<object, _T>::value, "_T must be inherit from object");
 		return std::move(object_shared_ref<_T>(p_obj));
 	}
-	template<typename _T>
-	inline object_shared_ref<_T> get_shared_ref(const ref<_T>& obj_ref)
+	template<typename _T, typename _C>
+	inline object_shared_ref<_T> get_shared_ref(const ref<_T, _C>& obj_ref)
 	{
 		static_assert(std::is_base_of<object, _T>::value, "_T must be inherit from object");
 		return std::move(object_shared_ref<_T>(obj_ref));
@@ -201,7 +352,8 @@ _T* object_factory::new_obj(_Args&&... args)
 {
 	static_assert(std::is_base_of<object, _T>::value, "_T must be inherit from object");
 
-	void* user_mem = _mem_pool.alloc<_T>();
+	auto& context = _cur_context();
+	void* user_mem = context.obj_mem_cache.alloc<_T>();
 	if (nullptr == user_mem)
 	{
 		return nullptr;
@@ -214,6 +366,7 @@ _T* object_factory::new_obj(_Args&&... args)
 	}
 
 	_init_obj(p, user_mem);
+	_init_relocate(p, user_mem);
 	return p;
 }
 
@@ -222,7 +375,8 @@ _T* object_factory::new_obj(std::initializer_list<_E> list)
 {
 	static_assert(std::is_base_of<object, _T>::value, "_T must be inherit from object");
 
-	void* user_mem = _mem_pool.alloc<_T>();
+	auto& context = _cur_context();
+	void* user_mem = context.obj_mem_cache.alloc<_T>();
 	if (nullptr == user_mem)
 	{
 		return nullptr;
@@ -235,9 +389,68 @@ _T* object_factory::new_obj(std::initializer_list<_E> list)
 	}
 
 	_init_obj(p, user_mem);
+	_init_relocate(p, user_mem);
 	return p;
 }
 
+template<typename _T, typename _Construct>
+size_t object_factory::_new_objs(_T** objs, size_t count, _Construct construct)
+{
+	static_assert(std::is_base_of<object, _T>::value, "_T must be inherit from object");
+
+	auto& context = _cur_context();
+	void* user_mems[_NewObjsChunkCount];
+	size_t created_count = 0;
+	while (created_count < count)
+	{
+		auto chunk_count = count - created_count;
+		if (_NewObjsChunkCount < chunk_count)
+		{
+			chunk_count = _NewObjsChunkCount;
+		}
+		auto alloc_count = context.obj_mem_cache.alloc_batch<_T>(user_mems, chunk_count);
+		auto chunk_objs = objs + created_count;
+		size_t constructed_count = 0;
+		try
+		{
+			for (; constructed_count < alloc_count; ++constructed_count)
+			{
+				auto p = construct(user_mems[constructed_count], created_count + constructed_count);
+				static_cast<object*>(p)->_mem = user_mems[constructed_count];
+				chunk_objs[constructed_count] = p;
+			}
+		}
+		catch (...)
+		{
+			// no half built batch stays behind: this chunk has no handles yet, the chunks before are complete objects
+			for (size_t i = 0; i < constructed_count; ++i)
+			{
+				static_cast<object*>(chunk_objs[i])->~object();
+			}
+			for (size_t i = 0; i < alloc_count; ++i)
+			{
+				context.obj_mem_cache.free(user_mems[i]);
+			}
+			for (size_t i = 0; i < created_count; ++i)
+			{
+				_delete_obj_immediately(objs[i]);
+			}
+			throw;
+		}
+		_init_obj_handles(chunk_objs, alloc_count);
+		for (size_t i = 0; i < alloc_count; ++i)
+		{
+			_init_relocate(chunk_objs[i], user_mems[i]);
+		}
+		created_count += alloc_count;
+		if (alloc_count < chunk_count)
+		{
+			break;
+		}
+	}
+	return created_count;
+}
+
 CORE_NAMESPACE_END
 
 #endif
\ No newline at end of file
@@ -0,0 +1,91 @@
+
+#include "object_handle_table.h"
+#include "environment.h"
+#include "bug_reporter.h"
+#include <new>
+
+CORE_NAMESPACE_BEG
+
+std::atomic<object_handle_table::_slot*> object_handle_table::_s_pages[object_handle_table::_MaxPageCount] = {};
+uint32_t object_handle_table::_s_slot_count = 0;
+uint32_t object_handle_table::_s_free_head = object_handle_table::_NoFreeSlot;
+std::mutex object_handle_table::_s_mutex;
+
+object_handle_table::handle_type object_handle_table::acquire(support_weak_ref* p)
+{
+	std::lock_guard<std::mutex> lock(_s_mutex);
+	return _acquire(p);
+}
+
+object_handle_table::handle_type object_handle_table::_acquire(support_weak_ref* p)
+{
+	uint32_t index = _s_free_head;
+	if (_NoFreeSlot != index)
+	{
+		auto& slot = _slot_of(index);
+		_s_free_head = slot.next_free;
+		slot.p.store(p, std::memory_order_release);
+		return _make_handle(index, slot.generation.load(std::memory_order_relaxed));
+	}
+
+	if (MaxSlotCount <= _s_slot_count)
+	{
+		environment::get_cur_bug_reporter().report(BUG_TAG_OBJECT_HANDLE_TABLE, "object_handle_table is full");
+		return InvalidHandle;
+	}
+	index = _s_slot_count++;
+	auto& page = _s_pages[index >> _PageBits];
+	if (nullptr == page.load(std::memory_order_relaxed))
+	{
+		page.store(new _slot[_PageSize](), std::memory_order_release);
+	}
+	auto& slot = _slot_of(index);
+	slot.p.store(p, std::memory_order_release);
+	slot.generation.store(1, std::memory_order_release);
+	return _make_handle(index, 1);
+}
+
+void object_handle_table::release(handle_type handle)
+{
+	if (InvalidHandle == handle)
+	{
+		return;
+	}
+	auto index = static_cast<uint32_t>(handle);
+	auto generation = static_cast<uint32_t>(handle >> 32);
+	std::lock_guard<std::mutex> lock(_s_mutex);
+	auto& slot = _slot_of(index);
+	if (slot.generation.load(std::memory_order_relaxed) != generation)
+	{
+		environment::get_cur_bug_reporter().report(BUG_TAG_OBJECT_HANDLE_TABLE, "object_handle_table release a stale handle");
+		return;
+	}
+	slot.p.store(nullptr, std::memory_order_release);
+	if (~uint32_t(0) == generation)
+	{
+		// retired, 0 matches no handle
+		slot.generation.store(0, std::memory_order_release);
+		return;
+	}
+	slot.generation.store(generation + 1, std::memory_order_release);
+	slot.next_free = _s_free_head;
+	_s_free_head = index;
+}
+
+void object_handle_table::rebind(handle_type handle, support_weak_ref* p)
+{
+	if (InvalidHandle == handle)
+	{
+		return;
+	}
+	std::lock_guard<std::mutex> lock(_s_mutex);
+	auto& slot = _slot_of(static_cast<uint32_t>(handle));
+	if (slot.generation.load(std::memory_order_relaxed) != static_cast<uint32_t>(handle >> 32))
+	{
+		environment::get_cur_bug_reporter().report(BUG_TAG_OBJECT_HANDLE_TABLE, "object_handle_table rebind a stale handle");
+		return;
+	}
+	slot.p.store(p, std::memory_order_release);
+}
+
+CORE_NAMESPACE_END
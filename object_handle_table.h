@@ -0,0 +1,112 @@
+
+#ifndef OBJECT_HANDLE_TABLE_H
+#define OBJECT_HANDLE_TABLE_H
+
+#include "core.h"
+#include "noncopyable.h"
+#include <atomic>
+#include <mutex>
+
+CORE_NAMESPACE_BEG
+
+class support_weak_ref;
+
+/// <summary>
+/// process wide slot map behind object_weak_ref, shared by all factories: a weak ref is just the handle, so it resolves
+/// on any thread and in any environment without knowing which factory made the object. a handle packs a 32-bit slot index and the 32-bit generation the slot had
+/// when it was issued; release bumps the generation, so stale handles fail a check against the slot and never read the object.
+/// a slot whose generation would wrap is retired instead of reused.
+/// resolve is lock-free and may run on any thread, acquire, release and rebind take a mutex.
+/// all state is constant initialized, objects may be created before main
+/// </summary>
+class object_handle_table {
+	object_handle_table() = delete;
+
+public:
+	typedef uint64_t handle_type;
+	static const handle_type InvalidHandle = 0;
+
+private:
+	struct _slot {
+		std::atomic<support_weak_ref*> p;
+		// 0 only before the slot is first used, so no valid handle is 0
+		std::atomic<uint32_t> generation;
+		uint32_t next_free;
+	};
+
+	static const size_t _PageBits = 12;
+	static const size_t _PageSize = size_t(1) << _PageBits;
+	static const size_t _MaxPageCount = 4096;
+	static const uint32_t _NoFreeSlot = ~uint32_t(0);
+
+	// slots by index, pages are allocated under the mutex and live as long as the process
+	static std::atomic<_slot*> _s_pages[_MaxPageCount];
+	static uint32_t _s_slot_count;
+	static uint32_t _s_free_head;
+	static std::mutex _s_mutex;
+
+public:
+	static const size_t MaxSlotCount = _PageSize * _MaxPageCount;
+
+	/// <summary>
+	/// a handle for p, InvalidHandle when the table is full
+	/// </summary>
+	static handle_type acquire(support_weak_ref* p);
+	/// <summary>
+	/// holds the table mutex, so a batch of objects gets its handles with one lock
+	/// </summary>
+	class batch_acquirer final : noncopyable {
+		std::lock_guard<std::mutex> _lock;
+
+	public:
+		inline batch_acquirer() : _lock(_s_mutex) {}
+		inline handle_type acquire(support_weak_ref* p) { return _acquire(p); }
+	};
+	/// <summary>
+	/// invalidates every copy of the handle, InvalidHandle is ignored
+	/// </summary>
+	static void release(handle_type handle);
+	/// <summary>
+	/// points a live handle at the new address of its moved object
+	/// </summary>
+	static void rebind(handle_type handle, support_weak_ref* p);
+	/// <summary>
+	/// the object of handle, or nullptr once the handle was released
+	/// </summary>
+	inline static support_weak_ref* resolve(handle_type handle)
+	{
+		if (InvalidHandle == handle)
+		{
+			return nullptr;
+		}
+		auto& slot = _slot_of(static_cast<uint32_t>(handle));
+		auto generation = static_cast<uint32_t>(handle >> 32);
+		if (slot.generation.load(std::memory_order_acquire) != generation)
+		{
+			return nullptr;
+		}
+		auto p = slot.p.load(std::memory_order_acquire);
+		// the slot may have been released and reused between the loads, p would be the new object then.
+		// p is stored with release after the generation bump, so seeing the new p means seeing the new generation
+		if (slot.generation.load(std::memory_order_relaxed) != generation)
+		{
+			return nullptr;
+		}
+		return p;
+	}
+
+private:
+	static handle_type _acquire(support_weak_ref* p);
+	inline static _slot& _slot_of(uint32_t index)
+	{
+		return _s_pages[index >> _PageBits].load(std::memory_order_acquire)[index & (_PageSize - 1)];
+	}
+	inline static handle_type _make_handle(uint32_t index, uint32_t generation)
+	{
+		return (static_cast<handle_type>(generation) << 32) | index;
+	}
+};
+
+CORE_NAMESPACE_END
+
+#endif
@@ -9,9 +9,11 @@
 #include "object_weak_ref.h"
 #include "object_temp_ref.h"
 #include "containers.h"
+#include "small_vector.h"
+#include "btree_map.h"
 #include <type_traits>
 #include <utility>
-#include <map>
+#include <algorithm>
 
 CORE_NAMESPACE_BEG
 
@@ -24,10 +26,13 @@ public:
     using temp_ref = object_temp_ref<_TObj>;
     using ref = _TObj*;
 
-    using weak_ref_array = vector<weak_ref>;
+    using weak_ref_array = small_vector<weak_ref, 8>;
 
 private:
-	using _map_type = std::map<id_type, ref>;
+    // support_relocate objects are kept by handle so compact_step() can move them, any other by address.
+    // a support_relocate _T created under a _TObj that is not stays pinned while managed
+    using _stored_ref = typename std::conditional<std::is_base_of<support_relocate, _TObj>::value, weak_ref, ref>::type;
+	using _map_type = btree_map<id_type, _stored_ref>;
 
 private:
     _map_type _map;
@@ -46,6 +51,13 @@ public:
     template<typename _T, typename ..._Args>
     object_weak_ref<_T> create(id_type id, _Args&&... args);
 
+    /// <summary>
+    /// create() for every id in [first_id, last_id), the cells and handles are taken in bulk.
+    /// ids already in the manager and repeated ids are skipped, the refs come back in ascending id order
+    /// </summary>
+    template<typename _T = _TObj, typename _It, typename ..._Args>
+    small_vector<object_weak_ref<_T>, 8> create_batch(_It first_id, _It last_id, const _Args&... args);
+
     /// <summary>
     /// deconstruct in frame end
     /// </summary>
@@ -100,6 +112,33 @@ public:
 
 private:
     void _destroy(id_type id, void (object_factory::* delete_fuc)(object*));
+
+    inline static ref _get(ref obj_ref) { return obj_ref; }
+    inline static ref _get(weak_ref w_ref) { return w_ref.operator->(); }
+    inline _stored_ref _to_stored(ref obj_ref) const { return _to_stored(obj_ref, static_cast<_stored_ref*>(nullptr)); }
+    inline static ref _to_stored(ref obj_ref, ref*) { return obj_ref; }
+    inline weak_ref _to_stored(ref obj_ref, weak_ref*) const { return _obj_factory.get_weak_ref(obj_ref); }
+    template<typename _T>
+    inline static void _pin(_T* p_obj) { _pin(p_obj, static_cast<_stored_ref*>(nullptr)); }
+    template<typename _T>
+    inline static void _pin(_T* p_obj, ref*) { relocate_pin_utils::pin(p_obj); }
+    template<typename _T>
+    inline static void _pin(_T*, weak_ref*) {}
+    inline void _unpin(ref obj_ref) const { _unpin(obj_ref, static_cast<_stored_ref*>(nullptr)); }
+    inline void _unpin(ref obj_ref, ref*) const
+    {
+        // only a relocatable subtype was pinned, no cross cast while the factory has none
+        if (0 == _obj_factory._relocatable_count.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        auto p_relocate = cast_utils<_TObj, support_relocate>::cast(obj_ref);
+        if (nullptr != p_relocate)
+        {
+            relocate_pin_utils::unpin(p_relocate);
+        }
+    }
+    inline void _unpin(ref, weak_ref*) const {}
 };
 
 template<typename _TID, typename _TObj>
@@ -107,7 +146,9 @@ object_manager<_TID, _TObj>::~object_manager()
 {
     for (auto& kv : _map)
     {
-        _obj_factory.delete_obj(kv.second);
+        auto obj_ref = _get(kv.second);
+        _unpin(obj_ref);
+        _obj_factory.delete_obj(obj_ref);
     }
     _map.clear();
 }
@@ -124,12 +165,38 @@ object_weak_ref<_T> object_manager<_TID, _TObj>::create(id_type id, _Args&&... a
     if (_map.end() == iter)
     {
         p_obj = _obj_factory.new_obj<_T>(id, std::forward<_Args>(args)...);
-        _map.insert(std::make_pair(id, ref(p_obj)));
+        _map.insert(std::make_pair(id, _to_stored(p_obj)));
+        _pin(p_obj);
     }
 
     return _obj_factory.get_weak_ref(p_obj);
 }
 
+template<typename _TID, typename _TObj>
+template<typename _T, typename _It, typename ..._Args>
+small_vector<object_weak_ref<_T>, 8> object_manager<_TID, _TObj>::create_batch(_It first_id, _It last_id, const _Args&... args)
+{
+    static_assert(std::is_base_of<_TObj, _T>::value, "_T must be inherit from _TObj");
+
+    small_vector<id_type, 64> ids(first_id, last_id);
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    ids.erase(std::remove_if(ids.begin(), ids.end(), [this](const id_type& id) { return _map.end() != _map.find(id); }), ids.end());
+
+    small_vector<_T*, 64> objs(ids.size());
+    auto count = _obj_factory.new_objs_with_ids(objs.data(), ids.data(), ids.size(), args...);
+
+    small_vector<object_weak_ref<_T>, 8> obj_refs;
+    obj_refs.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        _map.insert(std::make_pair(ids[i], _to_stored(objs[i])));
+        _pin(objs[i]);
+        obj_refs.push_back(_obj_factory.get_weak_ref(objs[i]));
+    }
+    return obj_refs;
+}
+
 template<typename _TID, typename _TObj>
 typename object_manager<_TID, _TObj>::weak_ref object_manager<_TID, _TObj>::try_get(id_type id) const
 {
@@ -139,7 +206,7 @@ typename object_manager<_TID, _TObj>::weak_ref object_manager<_TID, _TObj>::try_
         return weak_ref::null_ref;
     }
     
-    return _obj_factory.get_weak_ref(iter->second);
+    return _obj_factory.get_weak_ref(_get(iter->second));
 }
 
 template<typename _TID, typename _TObj>
@@ -151,7 +218,7 @@ typename object_manager<_TID, _TObj>::temp_ref& object_manager<_TID, _TObj>::try
         return temp_ref::null_ref;
     }
 
-    return _obj_factory.get_temp_ref(iter->second);
+    return _obj_factory.get_temp_ref(_get(iter->second));
 }
 
 template<typename _TID, typename _TObj>
@@ -160,9 +227,9 @@ typename object_manager<_TID, _TObj>::weak_ref object_manager<_TID, _TObj>::find
 {
     for (const auto& kv : _map)
     {
-        if (pred(_obj_factory.get_temp_ref(kv.second)))
+        if (pred(_obj_factory.get_temp_ref(_get(kv.second))))
         {
-            return _obj_factory.get_weak_ref(kv.second);
+            return _obj_factory.get_weak_ref(_get(kv.second));
         }
     }
     return weak_ref::null_ref;
@@ -174,7 +241,7 @@ typename object_manager<_TID, _TObj>::temp_ref& object_manager<_TID, _TObj>::fin
 {
     for (const auto& kv : _map)
     {
-        auto& obj_temp_ref = _obj_factory.get_temp_ref(kv.second);
+        auto& obj_temp_ref = _obj_factory.get_temp_ref(_get(kv.second));
         if (pred(obj_temp_ref))
         {
             return obj_temp_ref;
@@ -190,10 +257,10 @@ typename object_manager<_TID, _TObj>::weak_ref_array object_manager<_TID, _TObj>
     weak_ref_array objs;
     for (const auto& kv : _map)
     {
-        auto& obj_temp_ref = _obj_factory.get_temp_ref(kv.second);
+        auto& obj_temp_ref = _obj_factory.get_temp_ref(_get(kv.second));
         if (pred(obj_temp_ref))
         {
-            objs.push_back(std::move(_obj_factory.get_weak_ref(kv.second)));
+            objs.push_back(std::move(_obj_factory.get_weak_ref(_get(kv.second))));
         }
     }
     return std::move(objs);
@@ -205,7 +272,7 @@ void object_manager<_TID, _TObj>::for_each(_F func) const
 {
     for (const auto& kv : _map)
     {
-        func(_obj_factory.get_temp_ref(kv.second));
+        func(_obj_factory.get_temp_ref(_get(kv.second)));
     }
 }
 
@@ -215,7 +282,7 @@ void object_manager<_TID, _TObj>::for_each_interruptible(_P pred) const
 {
     for (const auto& kv : _map)
     {
-        if (!pred(_obj_factory.get_temp_ref(kv.second)))
+        if (!pred(_obj_factory.get_temp_ref(_get(kv.second))))
         {
             break;
         }
@@ -231,8 +298,9 @@ void object_manager<_TID, _TObj>::_destroy(id_type id, void (object_factory::* d
         return;
     }
 
-    auto obj_ref = iter->second;
+    auto obj_ref = _get(iter->second);
     _map.erase(iter);
+    _unpin(obj_ref);
 
     (_obj_factory.*delete_fuc)(obj_ref);
 }
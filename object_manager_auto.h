@@ -41,6 +41,8 @@ public:
 		static_assert(std::is_base_of<_TObj, _T>::value, "_T must be inherit from _TObj");
 
 		_T* obj_ref = _obj_factory.new_obj<_T>(std::forward<_Args>(args)...);
+		// shared refs hold its address until it dies
+		relocate_pin_utils::pin(obj_ref);
 		return _obj_factory.get_shared_ref(obj_ref);
 	}
 };
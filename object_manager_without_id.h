@@ -6,10 +6,90 @@
 #include "object.h"
 #include "object_factory.h"
 #include "object_weak_ref.h"
-#include <set>
+#include "btree_map.h"
+#include "intrusive_list.h"
+#include "small_vector.h"
+#include <type_traits>
 
 CORE_NAMESPACE_BEG
 
+/// <summary>
+/// objects inheriting this join object_manager_without_id through an embedded list hook instead of a set node,
+/// so create and destroy are O(1) and allocation free
+/// </summary>
+class support_manager_hook {
+	template<typename _TObj, bool _Intrusive>
+	friend class _manager_obj_set;
+
+	intrusive_list_hook _manager_hook;
+	const void* _p_manager;
+
+protected:
+	inline support_manager_hook() : _manager_hook(), _p_manager(nullptr) {}
+};
+
+template<typename _TObj, bool _Intrusive = std::is_base_of<support_manager_hook, _TObj>::value>
+class _manager_obj_set {
+	btree_set<_TObj*> _objs;
+
+public:
+	inline void insert(const void* p_manager, _TObj* p_obj)
+	{
+		_objs.insert(p_obj);
+	}
+	inline bool erase(const void* p_manager, _TObj* p_obj)
+	{
+		return 0 != _objs.erase(p_obj);
+	}
+	template<typename _F>
+	void clear(_F func)
+	{
+		for (auto& v : _objs)
+		{
+			func(v);
+		}
+		_objs.clear();
+	}
+};
+
+template<typename _TObj>
+class _manager_obj_set<_TObj, true> {
+	intrusive_list<support_manager_hook, &support_manager_hook::_manager_hook> _objs;
+
+public:
+	inline void insert(const void* p_manager, _TObj* p_obj)
+	{
+		_objs.push_back(*p_obj);
+		p_obj->support_manager_hook::_p_manager = p_manager;
+	}
+	inline bool erase(const void* p_manager, _TObj* p_obj)
+	{
+		support_manager_hook* p_hook = p_obj;
+		if (p_manager != p_hook->_p_manager)
+		{
+			return false;
+		}
+		_objs.remove(*p_hook);
+		p_hook->_p_manager = nullptr;
+		return true;
+	}
+	template<typename _F>
+	void clear(_F func)
+	{
+		// unlink before func, it may destroy the object immediately
+		while (!_objs.empty())
+		{
+			auto p_hook = &_objs.front();
+			_objs.pop_front();
+			p_hook->_p_manager = nullptr;
+			func(static_cast<_TObj*>(p_hook));
+		}
+	}
+};
+
+/// <summary>
+/// keeps objects by address, support_relocate ones stay pinned while managed
+/// </summary>
 template<typename _TObj>
 class object_manager_without_id final : noncopyable {
 	static_assert(std::is_base_of<object, _TObj>::value, "_TObj must be inherit from object");
@@ -18,7 +98,7 @@ public:
 	using ref = _TObj*;
 
 private:
-	using _set_type = std::set<ref>;
+	using _set_type = _manager_obj_set<_TObj>;
 
 	_set_type _objs;
 	object_factory& _obj_factory;
@@ -30,11 +110,11 @@ public:
 	}
 	~object_manager_without_id()
 	{
-		for (auto& v : _objs)
+		_objs.clear([this](ref obj_ref)
 		{
-			_obj_factory.delete_obj(v);
-		}
-		_objs.clear();
+			relocate_pin_utils::unpin(obj_ref);
+			_obj_factory.delete_obj(obj_ref);
+		});
 	}
 
 public:
@@ -49,16 +129,39 @@ public:
 		static_assert(std::is_base_of<_TObj, _T>::value, "_T must be inherit from _TObj");
 
 		_T* obj_ref = _obj_factory.new_obj<_T>(std::forward<_Args>(args)...);
-		_objs.insert(obj_ref);
+		_objs.insert(this, obj_ref);
+		relocate_pin_utils::pin(obj_ref);
 		return _obj_factory.get_weak_ref(obj_ref);
 	}
 
+	/// <summary>
+	/// count objects of _T(args...), the cells and handles are taken in bulk. returns their refs in creation order
+	/// </summary>
+	template<typename _T = _TObj, typename ..._Args>
+	small_vector<object_weak_ref<_T>, 8> create_batch(size_t count, const _Args&... args)
+	{
+		static_assert(std::is_base_of<_TObj, _T>::value, "_T must be inherit from _TObj");
+
+		small_vector<_T*, 64> objs(count);
+		count = _obj_factory.new_objs(objs.data(), count, args...);
+
+		small_vector<object_weak_ref<_T>, 8> obj_refs;
+		obj_refs.reserve(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			_objs.insert(this, objs[i]);
+			relocate_pin_utils::pin(objs[i]);
+			obj_refs.push_back(_obj_factory.get_weak_ref(objs[i]));
+		}
+		return obj_refs;
+	}
+
 	/// <summary>
 	/// deconstruct in frame end
 	/// </summary>
 	void destroy(weak_ref w_ref)
 	{
-		_destroy(w_ref.operator->(), &object_factory::_delete_obj);
+		_destroy(w_ref, &object_factory::_delete_obj);
 	}
 
 	/// <summary>
@@ -66,16 +169,23 @@ public:
 	/// </summary>
 	void destroy_immediately(weak_ref w_ref)
 	{
-		_destroy(w_ref.operator->(), &object_factory::_delete_obj_immediately);
+		_destroy(w_ref, &object_factory::_delete_obj_immediately);
 	}
 
 private:
-	inline void _destroy(ref obj_ref, void (object_factory::* delete_fuc)(object*))
+	inline void _destroy(weak_ref& w_ref, void (object_factory::* delete_fuc)(object*))
 	{
-		if (0 == _objs.erase(obj_ref))
+		// an expired weak_ref may point at memory reused by another object, and operator-> would report it
+		if (nullptr == w_ref)
+		{
+			return;
+		}
+		ref obj_ref = w_ref.operator->();
+		if (!_objs.erase(this, obj_ref))
 		{
 			return;
 		}
+		relocate_pin_utils::unpin(obj_ref);
 
 		(_obj_factory.*delete_fuc)(obj_ref);
 	}
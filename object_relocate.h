@@ -0,0 +1,59 @@
+
+#ifndef OBJECT_RELOCATE_H
+#define OBJECT_RELOCATE_H
+
+#include "core.h"
+#include "noncopyable.h"
+#include "sfinae_macros.h"
+
+CORE_NAMESPACE_BEG
+
+/// <summary>
+/// opts an object into object_factory::compact_step(). it is moved with memcpy, so apart from what on_relocated() fixes
+/// it must be trivially relocatable, and it must support_weak_ref so weak refs follow it.
+/// object_manager keeps such objects by handle, so they move while managed, but pins them under a _TObj that is not relocatable. holders of raw pointers that cannot follow
+/// a move pin the object instead: object_manager_without_id, object_manager_auto and anything using relocate_pin_utils.
+/// delay deleted objects never move. temp refs, monitor ptrs and other raw pointers are not updated,
+/// reach relocatable objects through weak refs
+/// </summary>
+class support_relocate : noncopyable {
+	friend class object_factory;
+	friend struct relocate_pin_utils;
+
+	// raw pointer holders that cannot follow a move, compact_step() leaves the object alone while any
+	uint32_t _pin_count;
+
+protected:
+	inline support_relocate() : _pin_count(0) {}
+	virtual ~support_relocate() {}
+
+protected:
+	/// <summary>
+	/// called on the object at its new address, the old address still holds the old bytes during the call
+	/// </summary>
+	virtual void on_relocated(const support_relocate* /*p_old*/) {}
+};
+
+/// <summary>
+/// pins support_relocate objects while a raw pointer to them is held, no-ops for any other type
+/// </summary>
+struct relocate_pin_utils {
+	template<typename _T, enable_if_convertible_int<_T*, support_relocate*> = 0>
+	inline static void pin(_T* p)
+	{
+		++static_cast<support_relocate*>(p)->_pin_count;
+	}
+	template<typename _T, enable_if_not_convertible_int<_T*, support_relocate*> = 0>
+	inline static void pin(_T*) {}
+	template<typename _T, enable_if_convertible_int<_T*, support_relocate*> = 0>
+	inline static void unpin(_T* p)
+	{
+		--static_cast<support_relocate*>(p)->_pin_count;
+	}
+	template<typename _T, enable_if_not_convertible_int<_T*, support_relocate*> = 0>
+	inline static void unpin(_T*) {}
+};
+
+CORE_NAMESPACE_END
+
+#endif
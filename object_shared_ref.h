@@ -17,6 +17,24 @@ CORE_NAMESPACE_BEG
 
 class object;
 
+#if ENABLE_REF_SAFE_CHECK
+struct object_shared_ref_checker {
+	template<typename _T>
+	inline explicit object_shared_ref_checker(const _T*) {}
+
+	template<typename _T>
+	inline static void check(const _T* p)
+	{
+		if (nullptr == p)
+		{
+			environment::get_current_env().get_bug_reporter().report(BUG_TAG_SHARED_REF, "shared_ref is nullptr!");
+		}
+	}
+};
+#else
+using object_shared_ref_checker = ref_unchecked;
+#endif // REF_SAFE_CHECK
+
 class support_shared_ref : noncopyable {
 	friend class object_factory;
 	template<typename _T, typename _Deleter>
@@ -30,10 +48,10 @@ protected:
 };
 
 template<typename _T, typename _Deleter>
-class object_shared_ref final : public ref<_T> {
+class object_shared_ref final : public ref<_T, object_shared_ref_checker> {
 	static_assert(std::is_base_of<support_shared_ref, _T>::value, "_T must be inherit from support_shared_ref");
-
-	_T* _p;
+	using _base_type = ref<_T, object_shared_ref_checker>;
+	using _base_type::_p;
 
 public:
 	static object_shared_ref null_ref;
@@ -41,8 +59,9 @@ public:
 private:
 	friend class object_factory;
 	friend struct object_ref_utils;
-	inline explicit object_shared_ref(_T* p = nullptr) : ref<_T>(p) { _add_ref(); }
-	inline explicit object_shared_ref(const ref<_T>& obj_ref) : ref<_T>(obj_ref) { _add_ref(); }
+	inline explicit object_shared_ref(_T* p = nullptr) : _base_type(p) { _add_ref(); }
+	template<typename _C>
+	inline explicit object_shared_ref(const ref<_T, _C>& obj_ref) : _base_type(obj_ref) { _add_ref(); }
 
 public:
 	~object_shared_ref()
@@ -54,8 +73,8 @@ public:
 	}
 
 public:
-	inline object_shared_ref(const object_shared_ref& other) : _p(other._p) { _add_ref(); }
-	inline object_shared_ref(object_shared_ref&& other) : _p(other._p) { other._p = nullptr; }
+	inline object_shared_ref(const object_shared_ref& other) : _base_type(other._p) { _add_ref(); }
+	inline object_shared_ref(object_shared_ref&& other) : _base_type(other._p) { other._p = nullptr; }
 
 	inline object_shared_ref& operator=(const object_shared_ref& other)
 	{
@@ -97,27 +116,6 @@ private:
 		}
 		return --(static_cast<support_shared_ref*>(_p)->_ref_count);
 	}
-
-#if ENABLE_REF_SAFE_CHECK
-public:
-	inline const _T* operator->() const override
-	{
-		return _safe_ref();
-	}
-	inline _T* operator->() override
-	{
-		return _safe_ref();
-	}
-private:
-	inline _T* _safe_ref() const
-	{
-		if (nullptr == *this)
-		{
-			environment::get_current_env().get_bug_reporter().report(BUG_TAG_SHARED_REF, "shared_ref is nullptr!");
-		}
-		return _p;
-	}
-#endif // REF_SAFE_CHECK
 };
 
 template<typename _T, typename _Deleter>
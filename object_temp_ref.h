@@ -4,48 +4,57 @@
 #include "core.h"
 #include "noncopyable.h"
 #include "ref.h"
+#include "mem_cell.h"
 #include <type_traits>
 
-#if ENABLE_REF_SAFE_CHECK
+#if ENABLE_TEMP_REF_CHECK && CELL_GENERATION
 #include "environment.h"
 #include "bug_reporter.h"
-#include <set>
-#endif // REF_SAFE_CHECK
+#endif // ENABLE_TEMP_REF_CHECK && CELL_GENERATION
 
 CORE_NAMESPACE_BEG
 
-#if ENABLE_REF_SAFE_CHECK
 class object;
-class object_temp_ref_destroyed_pointers {
-	object_temp_ref_destroyed_pointers() = delete;
-	friend class object_factory;
-	template<typename _T>
-	friend class object_temp_ref;
 
-	using _pointer_set_type = std::set<object*>;
-	static _pointer_set_type _s_destroyed_pointers;
-	inline static void add_destroyed_pointer(object* p)
-	{
-		_s_destroyed_pointers.insert(p);
-	}
-	inline static void clear_destroyed_pointers()
+#if ENABLE_TEMP_REF_CHECK && CELL_GENERATION
+/// <summary>
+/// keeps the generation the object's cell had when the temp ref was taken, object_factory bumps it on destroy.
+/// the check reads only the cell header, never the object. cells must stay in their pool while temp refs live,
+/// so release pool memory between frames
+/// </summary>
+class object_temp_ref_checker {
+	const uint16_t* _p_generation;
+	uint16_t _generation;
+
+public:
+	template<typename _T>
+	inline explicit object_temp_ref_checker(const _T* p)
+		: _p_generation(nullptr != p ? mem_cell::get_cell(static_cast<const object*>(p)->_mem).generation() : nullptr)
+		, _generation(nullptr != p ? mem_cell::load_generation(_p_generation) : 0)
 	{
-		_s_destroyed_pointers.clear();
 	}
-	inline static void check_and_report(object* p)
+
+	template<typename _T>
+	inline void check(const _T*) const
 	{
-		if (_s_destroyed_pointers.end() != _s_destroyed_pointers.find(p))
+		if (nullptr != _p_generation && _generation != mem_cell::load_generation(_p_generation))
 		{
 			environment::get_current_env().get_bug_reporter().report(BUG_TAG_TEMP_REF, "temp_ref access destroyed pointer!");
 		}
 	}
 };
-#endif // REF_SAFE_CHECK
-
+#else
+class object_temp_ref_checker : public ref_unchecked {
+public:
+	template<typename _T>
+	inline explicit object_temp_ref_checker(const _T* p) : ref_unchecked(p) {}
+};
+#endif // ENABLE_TEMP_REF_CHECK && CELL_GENERATION
 
 template<typename _T>
-class object_temp_ref final : public ref<_T>, noncopyable {
+class object_temp_ref final : public ref<_T, object_temp_ref_checker>, noncopyable {
 	static_assert(std::is_base_of<object, _T>::value, "_T must be inherit from object");
+	using _base_type = ref<_T, object_temp_ref_checker>;
 
 	void* operator new(size_t, void* mem) noexcept { return mem; }
 	inline void operator delete(void*, void* mem) {}
@@ -56,29 +65,12 @@ public:
 private:
 	friend class object_factory;
 	friend struct object_ref_utils;
-	inline explicit object_temp_ref(_T* p) : ref<_T>(p) {}
-	inline explicit object_temp_ref(const ref<_T>& obj_ref) : ref<_T>(obj_ref) {}
+	inline explicit object_temp_ref(_T* p) : _base_type(p) {}
+	template<typename _TT, typename _C>
+	inline explicit object_temp_ref(const ref<_TT, _C>& obj_ref) : _base_type(obj_ref) {}
 
 public:
 	~object_temp_ref() {}
-
-#if ENABLE_REF_SAFE_CHECK
-public:
-	inline const _T* operator->() const override
-	{ 
-		return _safe_ref();
-	}
-	inline _T* operator->() override
-	{
-		return _safe_ref();
-	}
-private:
-	inline _T* _safe_ref() const
-	{
-		object_temp_ref_destroyed_pointers::check_and_report(static_cast<object*>(ref<_T>::_p));
-		return ref<_T>::_p;
-	}
-#endif // REF_SAFE_CHECK
 };
 
 template<typename _T>
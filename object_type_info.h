@@ -0,0 +1,64 @@
+
+#ifndef OBJECT_TYPE_INFO_H
+#define OBJECT_TYPE_INFO_H
+
+#include "core.h"
+#include "noncopyable.h"
+#include <type_traits>
+
+CORE_NAMESPACE_BEG
+
+/// <summary>
+/// type of an object subclass declared with OBJECT_TYPE_INFO. each keeps the chain of its registered bases indexed by depth,
+/// so is_a is one compare and casts through cast_utils and object_ref_utils need no dynamic_cast
+/// </summary>
+class object_type_info final : noncopyable {
+public:
+	static const size_t MaxDepth = 16;
+
+private:
+	size_t _depth;
+	// _ancestors[_depth] is this
+	const object_type_info* _ancestors[MaxDepth];
+
+public:
+	explicit object_type_info(const object_type_info* p_base)
+		: _depth(nullptr == p_base ? 0 : p_base->_depth + 1)
+		, _ancestors()
+	{
+		for (size_t i = 0; i < _depth; ++i)
+		{
+			_ancestors[i] = p_base->_ancestors[i];
+		}
+		_ancestors[_depth] = this;
+	}
+
+public:
+	inline size_t depth() const { return _depth; }
+	inline bool is_a(const object_type_info& base) const
+	{
+		return base._depth <= _depth && &base == _ancestors[base._depth];
+	}
+};
+
+CORE_NAMESPACE_END
+
+/// <summary>
+/// registers _Class, derived from the registered _Base (object itself or a class declared with this macro), put it in the class body.
+/// an unregistered class shares the type of its nearest registered base, casts to it fall back to dynamic_cast
+/// </summary>
+#define OBJECT_TYPE_INFO(_Class, _Base) \
+public: \
+	typedef _Class _object_type_self; \
+	static const size_t _object_type_depth = _Base::_object_type_depth + 1; \
+	static_assert(_object_type_depth < ::core::object_type_info::MaxDepth, "object type hierarchy is too deep"); \
+	static const ::core::object_type_info& static_type_info() \
+	{ \
+		static_assert(std::is_base_of<_Base, _Class>::value, "_Class must be inherit from _Base"); \
+		static const ::core::object_type_info s_type_info(&_Base::static_type_info()); \
+		return s_type_info; \
+	} \
+	virtual const ::core::object_type_info& get_type_info() const override { return static_type_info(); } \
+private:
+
+#endif
@@ -6,6 +6,7 @@
 #include "dis_new.h"
 #include "ref.h"
 #include "environment.h"
+#include "object_handle_table.h"
 #include <type_traits>
 
 CORE_NAMESPACE_BEG
@@ -14,52 +15,47 @@ class support_weak_ref : noncopyable {
 	friend class object_factory;
 	template<typename _T>
 	friend class object_weak_ref;
-	typedef int _id_type;
+	using _handle_type = object_handle_table::handle_type;
 
-	static const _id_type _INVALID_ID = 0;
-	static const _id_type _FIRST_ID = 1;
-
-	_id_type _instance_id;
+	_handle_type _handle;
 
 protected:
-    inline support_weak_ref() : _instance_id(_INVALID_ID) {};
-	virtual ~support_weak_ref() { _instance_id = _INVALID_ID; }
+    inline support_weak_ref() : _handle(object_handle_table::InvalidHandle) {};
+	virtual ~support_weak_ref()
+	{
+		// weak refs go null here, before the memory is freed or reused
+		object_handle_table::release(_handle);
+		_handle = object_handle_table::InvalidHandle;
+	}
 };
 
+/// <summary>
+/// 8 bytes, one handle of object_handle_table. checking it reads the table only, never the object
+/// </summary>
 template<typename _T>
 class object_weak_ref final : dis_new {
     static_assert(std::is_base_of<support_weak_ref, _T>::value, "_T must be inherit from support_weak_ref");
 
-	_T* _p;
-#if ENABLE_MEM_POOL_CLEANUP
-	bool* _p_pool_mem_freed;
-#endif // ENABLE_MEM_POOL_CLEANUP
-    support_weak_ref::_id_type _obj_id;
+    support_weak_ref::_handle_type _handle;
 
 public:
 	static object_weak_ref null_ref;
 
 private:
     friend class object_factory;
-    inline explicit object_weak_ref(_T* p, bool* p_pool_mem_freed = nullptr)
-        : _p(p)
-#if ENABLE_MEM_POOL_CLEANUP
-		, _p_pool_mem_freed(p_pool_mem_freed)
-#endif // ENABLE_MEM_POOL_CLEANUP
-        , _obj_id((nullptr != p) ? static_cast<support_weak_ref*>(p)->_instance_id : support_weak_ref::_INVALID_ID)
+    friend struct object_ref_utils;
+    inline explicit object_weak_ref(_T* p)
+        : _handle((nullptr != p) ? static_cast<support_weak_ref*>(p)->_handle : object_handle_table::InvalidHandle)
     {
     }
-    inline explicit object_weak_ref(const ref<_T>& obj_ref, bool* p_pool_mem_freed = nullptr)
-		: _p(const_cast<_T*>(obj_ref.operator->()))
-#if ENABLE_MEM_POOL_CLEANUP
-		, _p_pool_mem_freed(p_pool_mem_freed)
-#endif // ENABLE_MEM_POOL_CLEANUP
-        , _obj_id((nullptr != obj_ref) ? obj_ref->_instance_id : support_weak_ref::_INVALID_ID)
+    template<typename _C>
+    inline explicit object_weak_ref(const ref<_T, _C>& obj_ref)
+        : object_weak_ref(const_cast<_T*>(obj_ref.operator->()))
     {
     }
 
 public:
-    inline object_weak_ref() : _obj_id(support_weak_ref::_INVALID_ID), _p(nullptr) {}
+    inline object_weak_ref() : _handle(object_handle_table::InvalidHandle) {}
 
 public:
     /// <summary>
@@ -73,36 +69,36 @@ public:
 private:
     inline _T* _safe_ref() const
     {
+        auto p = _get();
 #if ENABLE_REF_SAFE_CHECK
-		if (nullptr == *this)
+		if (nullptr == p)
 		{
 			environment::get_current_env().get_bug_reporter().report(BUG_TAG_WEAK_REF, "weak_ref is nullptr!");
 		}
 #endif
-        return _p;
+        return p;
+    }
+    inline _T* _get() const
+    {
+        return static_cast<_T*>(object_handle_table::resolve(_handle));
     }
 
 public:
-    inline bool operator ==(const _T* p) const { return _p == p && (nullptr == p || p->_instance_id == _obj_id); }
+    inline bool operator ==(const _T* p) const { return _get() == p; }
     inline bool operator !=(const _T* p) const { return !operator ==(p); }
-    inline bool operator ==(const ref<_T>& rhs) const { return operator ==(rhs.operator->()); }
-    inline bool operator !=(const ref<_T>& rhs) const { return !operator ==(rhs.operator->()); }
-    inline bool operator ==(const object_weak_ref& rhs) const { return rhs._obj_id == _obj_id && rhs._p == _p; }
+    template<typename _C>
+    inline bool operator ==(const ref<_T, _C>& rhs) const { return operator ==(rhs.operator->()); }
+    template<typename _C>
+    inline bool operator !=(const ref<_T, _C>& rhs) const { return !operator ==(rhs.operator->()); }
+    inline bool operator ==(const object_weak_ref& rhs) const { return rhs._handle == _handle; }
     inline bool operator !=(const object_weak_ref& rhs) const { return !operator ==(rhs); }
-    inline bool operator ==(std::nullptr_t p) const { return p == _p || _pool_mem_freed() || _p->_instance_id != _obj_id; }
+    inline bool operator ==(std::nullptr_t) const { return nullptr == object_handle_table::resolve(_handle); }
     inline bool operator !=(std::nullptr_t p) const { return !operator ==(p); }
     template<typename _TT>
     friend bool operator ==(std::nullptr_t p, const object_weak_ref<_TT>& wp);
     template<typename _TT>
     friend bool operator !=(std::nullptr_t p, const object_weak_ref<_TT>& wp);
 
-private:
-#if ENABLE_MEM_POOL_CLEANUP
-	inline bool _pool_mem_freed() const { return nullptr != _p_pool_mem_freed && *_p_pool_mem_freed; }
-#else
-    inline constexpr bool _pool_mem_freed() const { return false; }
-#endif
-
 private:
     object_weak_ref* operator&() = delete;
 };
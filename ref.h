@@ -4,42 +4,72 @@
 
 #include "core.h"
 #include "dis_new.h"
+#include "sfinae_macros.h"
 
 CORE_NAMESPACE_BEG
 
-template<typename _T>
-class ref : dis_new {
+/// <summary>
+/// ref policy that checks nothing, operator-> is a plain load
+/// </summary>
+struct ref_unchecked {
+    inline ref_unchecked() {}
+    template<typename _T>
+    inline explicit ref_unchecked(const _T*) {}
+
+    template<typename _T>
+    inline static void check(const _T*) {}
+};
+
+/// <summary>
+/// a pointer and its _Checker, no vtable. the checker is a base constructed from the pointer, so a stateless one costs nothing,
+/// and its check(p) runs on every operator->. the derived refs pick a checking policy by their enable flags
+/// </summary>
+template<typename _T, typename _Checker = ref_unchecked>
+class ref : dis_new, protected _Checker {
+    template<typename _TT, typename _C>
+    friend class ref;
+
 protected:
     _T* _p;
 
 public:
-    inline explicit ref(_T* p = nullptr) : _p(p) {}
-    virtual ~ref() { _p = nullptr; }
+    inline explicit ref(_T* p = nullptr) : _Checker(p), _p(p) {}
+    template<typename _TT, typename _C, enable_if_convertible_int<_TT*, _T*> = 0>
+    inline explicit ref(const ref<_TT, _C>& other) : _Checker(_checker_of(other)), _p(other._p) {}
+    inline ~ref() { _p = nullptr; }
 
 public:
-    virtual const _T* operator->() const { return _p; }
-    virtual _T* operator->() { return _p; }
+    inline const _T* operator->() const { this->check(_p); return _p; }
+    inline _T* operator->() { this->check(_p); return _p; }
 
 public:
     inline bool operator ==(const _T* p) const { return _p == p; }
     inline bool operator !=(const _T* p) const { return _p != p; }
-    inline bool operator ==(const ref<_T>& rhs) const { return _p == rhs._p; }
-    inline bool operator !=(const ref<_T>& rhs) const { return _p != rhs._p; }
+    template<typename _C>
+    inline bool operator ==(const ref<_T, _C>& rhs) const { return _p == rhs._p; }
+    template<typename _C>
+    inline bool operator !=(const ref<_T, _C>& rhs) const { return _p != rhs._p; }
     inline bool operator ==(std::nullptr_t p) const { return p == _p; }
     inline bool operator !=(std::nullptr_t p) const { return p != _p; }
-    template<typename _TT>
-    friend bool operator ==(std::nullptr_t p, const ref<_TT>&wp);
-    template<typename _TT>
-	friend bool operator !=(std::nullptr_t p, const ref<_TT>& wp);
+    template<typename _TT, typename _C>
+    friend bool operator ==(std::nullptr_t p, const ref<_TT, _C>& wp);
+    template<typename _TT, typename _C>
+	friend bool operator !=(std::nullptr_t p, const ref<_TT, _C>& wp);
 
 private:
 	ref* operator&() = delete;
+
+    // the same policy hands over its state, so a stale ref stays stale when converted. another policy starts from the pointer
+    template<typename _TT>
+    inline static const _Checker& _checker_of(const ref<_TT, _Checker>& other) { return other; }
+    template<typename _TT, typename _C>
+    inline static const _TT* _checker_of(const ref<_TT, _C>& other) { return other._p; }
 };
 
-template<typename _T>
-inline bool operator ==(std::nullptr_t p, const ref<_T>& wp) { return p == wp._p; }
-template<typename _T>
-inline bool operator !=(std::nullptr_t p, const ref<_T>& wp) { return p != wp._p; }
+template<typename _T, typename _C>
+inline bool operator ==(std::nullptr_t p, const ref<_T, _C>& wp) { return p == wp._p; }
+template<typename _T, typename _C>
+inline bool operator !=(std::nullptr_t p, const ref<_T, _C>& wp) { return p != wp._p; }
 
 CORE_NAMESPACE_END
 
@@ -0,0 +1,366 @@
+
+#ifndef SMALL_VECTOR_H
+#define SMALL_VECTOR_H
+
+#include "core.h"
+#include "allocator.h"
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <iterator>
+#include <initializer_list>
+#include <stdexcept>
+#include <new>
+
+CORE_NAMESPACE_BEG
+
+/// <summary>
+/// vector that keeps up to _N elements inline and spills to _Alloc (mem_pool by default) beyond that.
+/// moving an inline small_vector moves the elements one by one, so iterators don't survive a move
+/// </summary>
+template<typename _T, size_t _N, typename _Alloc = allocator<_T>>
+class small_vector {
+	static_assert(0 < _N, "_N must be greater than 0");
+	using _alloc_traits = std::allocator_traits<_Alloc>;
+
+public:
+	using value_type = _T;
+	using size_type = size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = _T&;
+	using const_reference = const _T&;
+	using pointer = _T*;
+	using const_pointer = const _T*;
+	using iterator = _T*;
+	using const_iterator = const _T*;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	using allocator_type = _Alloc;
+
+	static const size_t InlineCapacity = _N;
+
+private:
+	_T* _data;
+	size_t _size;
+	size_t _capacity;
+	_Alloc _alloc;
+	alignas(_T) unsigned char _inline_buf[sizeof(_T) * _N];
+
+public:
+	inline small_vector() : _data(_inline_data()), _size(0), _capacity(_N), _alloc() {}
+	explicit small_vector(size_t count) : small_vector()
+	{
+		resize(count);
+	}
+	small_vector(size_t count, const _T& value) : small_vector()
+	{
+		resize(count, value);
+	}
+	template<typename _It, typename = typename std::iterator_traits<_It>::iterator_category>
+	small_vector(_It first, _It last) : small_vector()
+	{
+		assign(first, last);
+	}
+	small_vector(std::initializer_list<_T> list) : small_vector()
+	{
+		assign(list.begin(), list.end());
+	}
+	small_vector(const small_vector& other) : small_vector()
+	{
+		assign(other.begin(), other.end());
+	}
+	small_vector(small_vector&& other) noexcept(std::is_nothrow_move_constructible<_T>::value) : small_vector()
+	{
+		_take(std::move(other));
+	}
+	~small_vector()
+	{
+		clear();
+		_release();
+	}
+
+	small_vector& operator=(const small_vector& other)
+	{
+		if (this != std::addressof(other))
+		{
+			assign(other.begin(), other.end());
+		}
+		return *this;
+	}
+	small_vector& operator=(small_vector&& other) noexcept(std::is_nothrow_move_constructible<_T>::value)
+	{
+		if (this != std::addressof(other))
+		{
+			clear();
+			_release();
+			_take(std::move(other));
+		}
+		return *this;
+	}
+	small_vector& operator=(std::initializer_list<_T> list)
+	{
+		assign(list.begin(), list.end());
+		return *this;
+	}
+
+public:
+	inline iterator begin() { return _data; }
+	inline const_iterator begin() const { return _data; }
+	inline const_iterator cbegin() const { return _data; }
+	inline iterator end() { return _data + _size; }
+	inline const_iterator end() const { return _data + _size; }
+	inline const_iterator cend() const { return _data + _size; }
+	inline reverse_iterator rbegin() { return reverse_iterator(end()); }
+	inline const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+	inline reverse_iterator rend() { return reverse_iterator(begin()); }
+	inline const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+	inline size_t size() const { return _size; }
+	inline size_t capacity() const { return _capacity; }
+	inline bool empty() const { return 0 == _size; }
+	/// <summary>
+	/// true while the elements still live in the inline buffer
+	/// </summary>
+	inline bool is_inline() const { return _data == _inline_data(); }
+
+	inline _T* data() { return _data; }
+	inline const _T* data() const { return _data; }
+	inline _T& operator[](size_t index) { return _data[index]; }
+	inline const _T& operator[](size_t index) const { return _data[index]; }
+	inline _T& front() { return _data[0]; }
+	inline const _T& front() const { return _data[0]; }
+	inline _T& back() { return _data[_size - 1]; }
+	inline const _T& back() const { return _data[_size - 1]; }
+	_T& at(size_t index)
+	{
+		if (_size <= index)
+		{
+			throw std::out_of_range("small_vector::at");
+		}
+		return _data[index];
+	}
+	const _T& at(size_t index) const
+	{
+		if (_size <= index)
+		{
+			throw std::out_of_range("small_vector::at");
+		}
+		return _data[index];
+	}
+
+public:
+	template<typename ..._Args>
+	inline _T& emplace_back(_Args&&... args)
+	{
+		if (_size == _capacity)
+		{
+			return _emplace_back_grow(std::forward<_Args>(args)...);
+		}
+		auto p = ::new(static_cast<void*>(_data + _size)) _T(std::forward<_Args>(args)...);
+		++_size;
+		return *p;
+	}
+	inline void push_back(const _T& value) { emplace_back(value); }
+	inline void push_back(_T&& value) { emplace_back(std::move(value)); }
+	inline void pop_back()
+	{
+		--_size;
+		_data[_size].~_T();
+	}
+
+	template<typename ..._Args>
+	iterator emplace(const_iterator pos, _Args&&... args)
+	{
+		auto index = static_cast<size_t>(pos - _data);
+		if (index == _size)
+		{
+			emplace_back(std::forward<_Args>(args)...);
+			return _data + index;
+		}
+		// args may alias an element, build the value before shifting
+		_T value(std::forward<_Args>(args)...);
+		emplace_back(std::move(_data[_size - 1]));
+		for (auto i = _size - 2; i > index; --i)
+		{
+			_data[i] = std::move(_data[i - 1]);
+		}
+		_data[index] = std::move(value);
+		return _data + index;
+	}
+	inline iterator insert(const_iterator pos, const _T& value) { return emplace(pos, value); }
+	inline iterator insert(const_iterator pos, _T&& value) { return emplace(pos, std::move(value)); }
+
+	inline iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+	iterator erase(const_iterator first, const_iterator last)
+	{
+		auto p_first = _data + (first - _data);
+		auto p_last = _data + (last - _data);
+		if (p_first != p_last)
+		{
+			auto p_new_end = std::move(p_last, end(), p_first);
+			_destroy(p_new_end, end());
+			_size = static_cast<size_t>(p_new_end - _data);
+		}
+		return p_first;
+	}
+
+	template<typename _It>
+	void assign(_It first, _It last)
+	{
+		clear();
+		for (; first != last; ++first)
+		{
+			emplace_back(*first);
+		}
+	}
+
+	inline void clear()
+	{
+		_destroy(begin(), end());
+		_size = 0;
+	}
+
+	void reserve(size_t count)
+	{
+		if (count > _capacity)
+		{
+			_reallocate(count);
+		}
+	}
+	void resize(size_t count)
+	{
+		reserve(count);
+		while (_size < count)
+		{
+			::new(static_cast<void*>(_data + _size)) _T();
+			++_size;
+		}
+		erase(begin() + count, end());
+	}
+	void resize(size_t count, const _T& value)
+	{
+		reserve(count);
+		while (_size < count)
+		{
+			::new(static_cast<void*>(_data + _size)) _T(value);
+			++_size;
+		}
+		erase(begin() + count, end());
+	}
+
+	/// <summary>
+	/// give the heap storage back, elements move into the inline buffer when they fit
+	/// </summary>
+	void shrink_to_fit()
+	{
+		if (!is_inline() && _size < _capacity)
+		{
+			_reallocate(_size);
+		}
+	}
+
+	void swap(small_vector& other)
+	{
+		small_vector tmp(std::move(other));
+		other = std::move(*this);
+		*this = std::move(tmp);
+	}
+
+public:
+	bool operator==(const small_vector& rhs) const
+	{
+		if (_size != rhs._size)
+		{
+			return false;
+		}
+		for (size_t i = 0; i < _size; ++i)
+		{
+			if (!(_data[i] == rhs._data[i]))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+	inline bool operator!=(const small_vector& rhs) const { return !operator==(rhs); }
+
+private:
+	inline _T* _inline_data() { return reinterpret_cast<_T*>(_inline_buf); }
+	inline const _T* _inline_data() const { return reinterpret_cast<const _T*>(_inline_buf); }
+
+	template<typename ..._Args>
+	_T& _emplace_back_grow(_Args&&... args)
+	{
+		// construct first, args may refer to an element that is about to be relocated
+		_T value(std::forward<_Args>(args)...);
+		_reallocate(_capacity * 2);
+		auto p = ::new(static_cast<void*>(_data + _size)) _T(std::move(value));
+		++_size;
+		return *p;
+	}
+
+	void _reallocate(size_t new_capacity)
+	{
+		_T* new_data;
+		if (new_capacity <= _N)
+		{
+			new_data = _inline_data();
+			new_capacity = _N;
+		}
+		else
+		{
+			new_data = _alloc_traits::allocate(_alloc, new_capacity);
+		}
+		for (size_t i = 0; i < _size; ++i)
+		{
+			::new(static_cast<void*>(new_data + i)) _T(std::move_if_noexcept(_data[i]));
+			_data[i].~_T();
+		}
+		_release();
+		_data = new_data;
+		_capacity = new_capacity;
+	}
+
+	// steals heap storage, inline elements are moved one by one; other is left empty and inline
+	void _take(small_vector&& other)
+	{
+		if (other.is_inline())
+		{
+			for (size_t i = 0; i < other._size; ++i)
+			{
+				::new(static_cast<void*>(_data + i)) _T(std::move(other._data[i]));
+			}
+			_size = other._size;
+			other.clear();
+			return;
+		}
+		_data = other._data;
+		_size = other._size;
+		_capacity = other._capacity;
+		other._data = other._inline_data();
+		other._size = 0;
+		other._capacity = _N;
+	}
+
+	void _release()
+	{
+		if (!is_inline())
+		{
+			_alloc_traits::deallocate(_alloc, _data, _capacity);
+			_data = _inline_data();
+			_capacity = _N;
+		}
+	}
+
+	inline static void _destroy(_T* first, _T* last)
+	{
+		for (; first != last; ++first)
+		{
+			first->~_T();
+		}
+	}
+};
+
+CORE_NAMESPACE_END
+
+#endif
@@ -0,0 +1,775 @@
+#include "test_containers.h"
+#include "containers.h"
+#include "small_vector.h"
+#include "btree_map.h"
+#include "concurrent_queue.h"
+#include "realloc_vector.h"
+#include "atom_table.h"
+#include "utils.h"
+#include <ctime>
+#include <iomanip>
+#include <thread>
+#include <deque>
+#include <iterator>
+
+CORE_NAMESPACE_BEG
+
+// containers allocate through mem_pool_utils, give each test a fresh pool so leaks show up as used cells
+class _scoped_mem_pool : noncopyable {
+	mem_pool _pool;
+	mem_pool* _p_prev_pool;
+
+public:
+	_scoped_mem_pool() : _pool(), _p_prev_pool(mem_pool_utils::p_mem_pool)
+	{
+		mem_pool_utils::p_mem_pool = &_pool;
+	}
+	~_scoped_mem_pool()
+	{
+		mem_pool_utils::p_mem_pool = _p_prev_pool;
+	}
+};
+
+bool test_containers::test_flat_hash_map()
+{
+	_scoped_mem_pool scoped_pool;
+	const int test_count = 10000;
+
+	// check insert and find
+	flat_hash_map<int, int> m;
+	for (int i = 0; i < test_count; ++i)
+	{
+		m.emplace(i, i * 2);
+	}
+	for (int i = 0; i < test_count; ++i)
+	{
+		auto iter = m.find(i);
+		if (m.end() == iter || i * 2 != iter->second)
+		{
+			_out << console_text::RED;
+			_out << "test_flat_hash_map failed: key " << i << " is not found" << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+	}
+	if (static_cast<size_t>(test_count) != m.size() || m.contains(test_count))
+	{
+		_out << console_text::RED;
+		_out << "test_flat_hash_map failed: size is not " << test_count << ", it is " << m.size() << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_flat_hash_map check insert: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check erase, and that tombstones are reused without growing
+	for (int i = 0; i < test_count; i += 2)
+	{
+		m.erase(i);
+	}
+	auto capacity = m.capacity();
+	for (int round = 0; round < 10; ++round)
+	{
+		for (int i = 0; i < test_count; i += 2)
+		{
+			m[i + test_count * (round + 1)] = i;
+		}
+		for (int i = 0; i < test_count; i += 2)
+		{
+			m.erase(i + test_count * (round + 1));
+		}
+	}
+	size_t iter_count = 0;
+	for (auto& kv : m)
+	{
+		if (0 == kv.first % 2 || kv.first * 2 != kv.second)
+		{
+			_out << console_text::RED;
+			_out << "test_flat_hash_map failed: key " << kv.first << " is invalid after erase" << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+		++iter_count;
+	}
+	if (static_cast<size_t>(test_count / 2) != iter_count || capacity != m.capacity())
+	{
+		_out << console_text::RED;
+		_out << "test_flat_hash_map failed: iterated " << iter_count << " of " << test_count / 2 << ", capacity " << m.capacity() << " of " << capacity << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_flat_hash_map check erase: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check heterogeneous lookup
+	flat_hash_map<string, int, string_hash, string_equal_to> names;
+	names.try_emplace(string("entity"), 1);
+	names.insert_or_assign(string("entity"), 2);
+	if (!names.contains("entity") || 2 != names.find(std::string_view("entity"))->second || 1 != names.erase("entity") || !names.empty())
+	{
+		_out << console_text::RED;
+		_out << "test_flat_hash_map failed: heterogeneous lookup" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_flat_hash_map check heterogeneous lookup: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+bool test_containers::test_small_vector()
+{
+	_scoped_mem_pool scoped_pool;
+	const int inline_count = 8;
+
+	// check elements stay inline up to the inline capacity
+	small_vector<string, inline_count> v;
+	for (int i = 0; i < inline_count; ++i)
+	{
+		v.emplace_back(std::to_string(i).c_str());
+	}
+	if (!v.is_inline() || static_cast<size_t>(inline_count) != v.size())
+	{
+		_out << console_text::RED;
+		_out << "test_small_vector failed: " << inline_count << " elements are not inline" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_small_vector check inline: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check spill, insert from an aliased element, erase and shrink back
+	v.push_back(v[0]);
+	v.insert(v.begin(), v.back());
+	v.erase(v.begin() + 1);
+	if (v.is_inline() || static_cast<size_t>(inline_count + 1) != v.size() || "0" != v.front() || "0" != v.back() || "7" != v[inline_count - 1])
+	{
+		_out << console_text::RED;
+		_out << "test_small_vector failed: elements are invalid after spill" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	v.pop_back();
+	v.shrink_to_fit();
+	auto moved = std::move(v);
+	if (!moved.is_inline() || static_cast<size_t>(inline_count) != moved.size() || !v.empty() || "7" != moved.back())
+	{
+		_out << console_text::RED;
+		_out << "test_small_vector failed: elements are invalid after shrink" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_small_vector check spill: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+bool test_containers::test_btree_map()
+{
+	_scoped_mem_pool scoped_pool;
+	const int test_count = 10000;
+
+	// check ordered insert across leaf and inner node splits
+	btree_map<int, int> m;
+	for (int i = test_count - 1; i >= 0; --i)
+	{
+		m.emplace(i * 2, i);
+	}
+	int expected = 0;
+	for (auto& kv : m)
+	{
+		if (expected * 2 != kv.first || expected != kv.second)
+		{
+			_out << console_text::RED;
+			_out << "test_btree_map failed: key " << kv.first << " is out of order, expect " << expected * 2 << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+		++expected;
+	}
+	if (test_count != expected)
+	{
+		_out << console_text::RED;
+		_out << "test_btree_map failed: iterated " << expected << " of " << test_count << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_btree_map check insert: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check range queries
+	auto lower = m.lower_bound(101);
+	auto upper = m.upper_bound(200);
+	if (m.end() == lower || 102 != lower->first || m.end() == upper || 202 != upper->first || 50 != std::distance(lower, upper))
+	{
+		_out << console_text::RED;
+		_out << "test_btree_map failed: range [101, 200] is invalid" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_btree_map check range: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check erase merges nodes and keeps order
+	m.erase(lower, upper);
+	for (int i = 0; i < test_count * 2; i += 6)
+	{
+		m.erase(i);
+	}
+	int prev_key = -1;
+	size_t iter_count = 0;
+	for (auto& kv : m)
+	{
+		if (prev_key >= kv.first || 0 == kv.first % 6 || (102 <= kv.first && 200 >= kv.first))
+		{
+			_out << console_text::RED;
+			_out << "test_btree_map failed: key " << kv.first << " is invalid after erase" << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+		prev_key = kv.first;
+		++iter_count;
+	}
+	if (m.size() != iter_count)
+	{
+		_out << console_text::RED;
+		_out << "test_btree_map failed: size is not " << iter_count << ", it is " << m.size() << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_btree_map check erase: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+// movable but not default constructible, the queues must not need more
+struct _queue_item {
+	size_t value;
+
+	explicit _queue_item(size_t v) : value(v) {}
+};
+
+bool test_containers::test_concurrent_queue()
+{
+	_scoped_mem_pool scoped_pool;
+	const size_t test_count = 100000;
+	const size_t expected_sum = test_count * (test_count - 1) / 2;
+
+	// check spsc keeps order across threads, the producer pushes in batches
+	spsc_queue<size_t> spsc(256);
+	size_t spsc_error_count = 0;
+	std::thread consumer([&]() {
+		size_t values[32];
+		for (size_t expected = 0; expected < test_count;)
+		{
+			auto count = spsc.try_pop_batch(values, 32);
+			for (size_t i = 0; i < count; ++i, ++expected)
+			{
+				spsc_error_count += expected != values[i] ? 1 : 0;
+			}
+		}
+	});
+	size_t values[16];
+	for (size_t next = 0; next < test_count;)
+	{
+		auto batch_count = test_count - next < 16 ? test_count - next : 16;
+		for (size_t i = 0; i < batch_count; ++i)
+		{
+			values[i] = next + i;
+		}
+		next += spsc.try_push_batch(values, batch_count);
+	}
+	consumer.join();
+	if (0 != spsc_error_count || !spsc.empty_approx())
+	{
+		_out << console_text::RED;
+		_out << "test_concurrent_queue failed: spsc popped " << spsc_error_count << " values out of order" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_concurrent_queue check spsc: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check mpmc loses and duplicates nothing with several producers and consumers
+	const size_t thread_count = 4;
+	mpmc_queue<size_t> mpmc(64);
+	std::atomic<size_t> popped_count(0);
+	std::atomic<size_t> popped_sum(0);
+	std::thread threads[thread_count * 2];
+	for (size_t t = 0; t < thread_count; ++t)
+	{
+		threads[t] = std::thread([&, t]() {
+			for (auto value = t; value < test_count; value += thread_count)
+			{
+				while (!mpmc.try_push(value))
+				{
+					std::this_thread::yield();
+				}
+			}
+		});
+		threads[thread_count + t] = std::thread([&]() {
+			size_t value;
+			while (test_count > popped_count.load())
+			{
+				if (mpmc.try_pop(value))
+				{
+					popped_sum += value;
+					++popped_count;
+				}
+			}
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	if (expected_sum != popped_sum.load() || !mpmc.empty_approx())
+	{
+		_out << console_text::RED;
+		_out << "test_concurrent_queue failed: mpmc popped sum " << popped_sum.load() << " is not " << expected_sum << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_concurrent_queue check mpmc: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check try_pop_batch moves values out of their cells without a default constructed one
+	const size_t item_count = 8;
+	mpmc_queue<_queue_item> item_mpmc(item_count);
+	for (size_t i = 0; i < item_count; ++i)
+	{
+		item_mpmc.try_emplace(i);
+	}
+	std::deque<_queue_item> items;
+	auto item_popped_count = item_mpmc.try_pop_batch(std::back_inserter(items), item_count);
+	size_t item_error_count = 0;
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		item_error_count += i != items[i].value ? 1 : 0;
+	}
+	if (item_count != item_popped_count || item_count != items.size() || 0 != item_error_count || !item_mpmc.empty_approx())
+	{
+		_out << console_text::RED;
+		_out << "test_concurrent_queue failed: mpmc try_pop_batch popped " << item_popped_count << " items, " << item_error_count << " out of order" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_concurrent_queue check mpmc batch: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+struct _intrusive_item {
+	int id;
+	intrusive_list_hook list_hook;
+	intrusive_hash_hook hash_hook;
+
+	explicit _intrusive_item(int i) : id(i) {}
+};
+struct _intrusive_item_hash {
+	inline size_t operator()(int id) const { return std::hash<int>()(id); }
+	inline size_t operator()(const _intrusive_item& item) const { return std::hash<int>()(item.id); }
+};
+struct _intrusive_item_equal_to {
+	inline bool operator()(int id, const _intrusive_item& item) const { return id == item.id; }
+	inline bool operator()(const _intrusive_item& lhs, const _intrusive_item& rhs) const { return lhs.id == rhs.id; }
+};
+
+bool test_containers::test_intrusive_containers()
+{
+	_scoped_mem_pool scoped_pool;
+	const int test_count = 1000;
+	// hooks are noncopyable, deque never moves its elements
+	std::deque<_intrusive_item> items;
+	for (int i = 0; i < test_count; ++i)
+	{
+		items.emplace_back(i);
+	}
+
+	// check list membership without allocation
+	intrusive_list<_intrusive_item, &_intrusive_item::list_hook> list;
+	for (auto& item : items)
+	{
+		list.push_back(item);
+	}
+	for (int i = 0; i < test_count; i += 2)
+	{
+		list.remove(items[i]);
+	}
+	int expected = 1;
+	for (auto& item : list)
+	{
+		if (expected != item.id)
+		{
+			_out << console_text::RED;
+			_out << "test_intrusive_containers failed: list item " << item.id << " is not " << expected << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+		expected += 2;
+	}
+	if (static_cast<size_t>(test_count / 2) != list.size() || items[0].list_hook.is_linked() || !items[1].list_hook.is_linked())
+	{
+		_out << console_text::RED;
+		_out << "test_intrusive_containers failed: list size is not " << test_count / 2 << ", it is " << list.size() << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	list.clear();
+	_out << "test_intrusive_containers check list: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check hash set lookup by id
+	intrusive_hash_set<_intrusive_item, &_intrusive_item::hash_hook, _intrusive_item_hash, _intrusive_item_equal_to> set;
+	for (auto& item : items)
+	{
+		set.insert(item);
+	}
+	_intrusive_item duplicate(7);
+	if (set.insert(duplicate) || &items[7] != set.find(7) || 1 != set.erase(7) || set.contains(7) || static_cast<size_t>(test_count - 1) != set.size())
+	{
+		_out << console_text::RED;
+		_out << "test_intrusive_containers failed: hash set lookup" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	set.clear();
+	_out << "test_intrusive_containers check hash set: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+bool test_containers::test_hive()
+{
+	_scoped_mem_pool scoped_pool;
+	const int test_count = 1000;
+	hive<int> h;
+	std::vector<int*> addresses;
+	for (int i = 0; i < test_count; ++i)
+	{
+		addresses.push_back(&*h.emplace(i));
+	}
+
+	// erase every other element by iterator, the survivors keep their address
+	for (auto it = h.begin(); it != h.end();)
+	{
+		it = 0 == *it % 2 ? h.erase(it) : std::next(it);
+	}
+	int expected = 1;
+	for (auto& value : h)
+	{
+		if (expected != value || addresses[value] != &value)
+		{
+			_out << console_text::RED;
+			_out << "test_hive failed: element " << value << " is not " << expected << " or moved" << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+		expected += 2;
+	}
+	_out << "test_hive check erase: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// inserts fill the erased slots before growing
+	auto capacity = h.capacity();
+	for (int i = 0; i < test_count / 2; ++i)
+	{
+		h.emplace(-i);
+	}
+	int sum = 0;
+	size_t count = 0;
+	for (auto it = h.end(); it != h.begin();)
+	{
+		sum += *--it;
+		++count;
+	}
+	int expected_sum = (test_count / 2) * (test_count / 2) - (test_count / 2) * (test_count / 2 - 1) / 2;
+	if (capacity != h.capacity() || static_cast<size_t>(test_count) != h.size() || h.size() != count || expected_sum != sum)
+	{
+		_out << console_text::RED;
+		_out << "test_hive failed: slot reuse, capacity " << capacity << " -> " << h.capacity() << ", sum " << sum << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	h.clear();
+	_out << "test_hive check slot reuse: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+bool test_containers::test_realloc_vector()
+{
+	_scoped_mem_pool scoped_pool;
+	const int test_count = 10000;
+
+	// ints grow through reallocate, across pool cells and into malloc spans
+	realloc_vector<int> ints;
+	for (int i = 0; i < test_count; ++i)
+	{
+		ints.push_back(i);
+	}
+	for (int i = 0; i < test_count; ++i)
+	{
+		if (i != ints[i])
+		{
+			_out << console_text::RED;
+			_out << "test_realloc_vector failed: ints[" << i << "] is " << ints[i] << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+	}
+	ints.erase(ints.begin(), ints.begin() + test_count / 2);
+	ints.shrink_to_fit();
+	if (static_cast<size_t>(test_count / 2) != ints.capacity() || test_count / 2 != ints.front() || test_count - 1 != ints.back())
+	{
+		_out << console_text::RED;
+		_out << "test_realloc_vector failed: shrink_to_fit lost elements" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_realloc_vector check relocatable: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// strings are not trivially copyable and take the move path
+	realloc_vector<std::string> strings;
+	for (int i = 0; i < test_count / 10; ++i)
+	{
+		strings.emplace_back(std::to_string(i));
+		strings.emplace_back(strings.front());
+	}
+	if (static_cast<size_t>(test_count / 5) != strings.size() || std::to_string(test_count / 10 - 1) != strings[strings.size() - 2] || "0" != strings.back())
+	{
+		_out << console_text::RED;
+		_out << "test_realloc_vector failed: strings are not kept" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_realloc_vector check move: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+bool test_containers::test_atom_table()
+{
+	_scoped_mem_pool scoped_pool;
+	const int test_count = 10000;
+	atom_table atoms;
+
+	// readers look names up while the owner thread interns them
+	std::atomic<bool> stop(false);
+	std::atomic<size_t> bad_count(0);
+	std::thread reader([&]() {
+		while (!stop.load(std::memory_order_acquire))
+		{
+			for (int i = 0; i < test_count; i += 7)
+			{
+				auto name = "atom_" + std::to_string(i);
+				auto a = atoms.find(name);
+				if (!a.is_null() && atoms.name_of(a) != name)
+				{
+					++bad_count;
+				}
+			}
+		}
+	});
+	std::vector<atom> interned;
+	for (int i = 0; i < test_count; ++i)
+	{
+		interned.push_back(atoms.intern("atom_" + std::to_string(i)));
+	}
+	stop.store(true, std::memory_order_release);
+	reader.join();
+	if (0 != bad_count || static_cast<size_t>(test_count) != atoms.size())
+	{
+		_out << console_text::RED;
+		_out << "test_atom_table failed: " << bad_count << " bad lookups, size " << atoms.size() << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_atom_table check concurrent find: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// interning again hands out the same id, atoms key hash maps as integers
+	flat_hash_map<atom, int> values;
+	for (int i = 0; i < test_count; ++i)
+	{
+		auto name = "atom_" + std::to_string(i);
+		if (interned[i] != atoms.intern(name) || interned[i] != atoms.find(name))
+		{
+			_out << console_text::RED;
+			_out << "test_atom_table failed: " << name << " is interned twice" << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+		values[interned[i]] = i;
+	}
+	if (!atoms.find("missing").is_null() || static_cast<size_t>(test_count) != values.size() || 7 != values[atoms.find("atom_7")])
+	{
+		_out << console_text::RED;
+		_out << "test_atom_table failed: lookup by atom" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_atom_table check intern: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+template<typename _M>
+void _test_hash_map_performance(size_t test_count)
+{
+	_scoped_mem_pool scoped_pool;
+
+	_M m;
+	for (size_t i = 0; i < test_count; i++)
+	{
+		m.emplace(static_cast<int>(i * 7919), static_cast<int>(i));
+	}
+	size_t found_count = 0;
+	for (size_t round = 0; round < 4; round++)
+	{
+		for (size_t i = 0; i < test_count * 2; i++)
+		{
+			found_count += m.count(static_cast<int>(i * 7919));
+		}
+	}
+	for (size_t i = 0; i < test_count; i += 2)
+	{
+		m.erase(static_cast<int>(i * 7919));
+	}
+	m.clear();
+	if (test_count * 4 != found_count)
+	{
+		std::terminate();
+	}
+}
+
+void test_containers::test_hash_map_performance()
+{
+	clock_t start, end;
+	size_t test_count = 10000 * 100;
+	_out << "test_count: " << string_format_utils::format_count(test_count) << std::endl;
+
+	start = clock();
+	_test_hash_map_performance<std::unordered_map<int, int>>(test_count);
+	end = clock();
+	auto spent_0 = end - start;
+	_out << "std::unordered_map spent clocks: " << spent_0 << std::endl;
+
+	start = clock();
+	_test_hash_map_performance<unordered_map<int, int>>(test_count);
+	end = clock();
+	auto spent_1 = end - start;
+	_out << "core::unordered_map spent clocks: " << spent_1 << std::endl;
+
+	start = clock();
+	_test_hash_map_performance<flat_hash_map<int, int>>(test_count);
+	end = clock();
+	auto spent_2 = end - start;
+	_out << "core::flat_hash_map spent clocks: " << spent_2 << std::endl;
+
+	_out << "flat_hash_map diff to std::unordered_map = " << spent_2 - spent_0;
+	_out << ", spent percent = " << std::setiosflags(std::ios::fixed) << std::setprecision(2) << spent_2 * 100.0 / spent_0 << "%" << std::endl;
+	_out << "flat_hash_map diff to core::unordered_map = " << spent_2 - spent_1;
+	_out << ", spent percent = " << std::setiosflags(std::ios::fixed) << std::setprecision(2) << spent_2 * 100.0 / spent_1 << "%" << std::endl;
+}
+
+template<typename _V>
+void _test_vector_growth_performance(size_t test_count)
+{
+	_scoped_mem_pool scoped_pool;
+
+	// many short-lived vectors of PODs that grow one element at a time
+	size_t sum = 0;
+	for (size_t round = 0; round < test_count / 1000; round++)
+	{
+		_V v;
+		for (size_t i = 0; i < 1000 + round % 1000; i++)
+		{
+			v.push_back(static_cast<int>(i));
+		}
+		sum += static_cast<size_t>(v.back());
+	}
+	if (0 == sum)
+	{
+		std::terminate();
+	}
+}
+
+void test_containers::test_vector_growth_performance()
+{
+	clock_t start, end;
+	size_t test_count = 10000 * 1000;
+	_out << "test_count: " << string_format_utils::format_count(test_count) << std::endl;
+
+	start = clock();
+	_test_vector_growth_performance<std::vector<int>>(test_count);
+	end = clock();
+	auto spent_0 = end - start;
+	_out << "std::vector spent clocks: " << spent_0 << std::endl;
+
+	start = clock();
+	_test_vector_growth_performance<vector<int>>(test_count);
+	end = clock();
+	auto spent_1 = end - start;
+	_out << "core::vector spent clocks: " << spent_1 << std::endl;
+
+	start = clock();
+	_test_vector_growth_performance<realloc_vector<int>>(test_count);
+	end = clock();
+	auto spent_2 = end - start;
+	_out << "core::realloc_vector spent clocks: " << spent_2 << std::endl;
+
+	_out << "realloc_vector diff to std::vector = " << spent_2 - spent_0;
+	_out << ", spent percent = " << std::setiosflags(std::ios::fixed) << std::setprecision(2) << spent_2 * 100.0 / spent_0 << "%" << std::endl;
+	_out << "realloc_vector diff to core::vector = " << spent_2 - spent_1;
+	_out << ", spent percent = " << std::setiosflags(std::ios::fixed) << std::setprecision(2) << spent_2 * 100.0 / spent_1 << "%" << std::endl;
+}
+
+template<typename _M>
+void _test_ordered_map_performance(size_t test_count)
+{
+	_scoped_mem_pool scoped_pool;
+
+	// IDs are handed out in increasing order, looked up at random and iterated in order
+	_M m;
+	for (size_t i = 0; i < test_count; i++)
+	{
+		m.emplace(static_cast<int>(i), static_cast<int>(i));
+	}
+	size_t found_count = 0;
+	for (size_t i = 0; i < test_count; i++)
+	{
+		found_count += m.count(static_cast<int>((i * 7919) % test_count));
+	}
+	size_t sum = 0;
+	for (size_t round = 0; round < 4; round++)
+	{
+		for (auto& kv : m)
+		{
+			sum += static_cast<size_t>(kv.second);
+		}
+	}
+	for (size_t i = 0; i < test_count; i += 2)
+	{
+		m.erase(static_cast<int>((i * 7919) % test_count));
+	}
+	m.clear();
+	if (test_count != found_count || 0 == sum)
+	{
+		std::terminate();
+	}
+}
+
+void test_containers::test_ordered_map_performance()
+{
+	clock_t start, end;
+	size_t test_count = 10000 * 100;
+	_out << "test_count: " << string_format_utils::format_count(test_count) << std::endl;
+
+	start = clock();
+	_test_ordered_map_performance<std::map<int, int>>(test_count);
+	end = clock();
+	auto spent_0 = end - start;
+	_out << "std::map spent clocks: " << spent_0 << std::endl;
+
+	start = clock();
+	_test_ordered_map_performance<map<int, int>>(test_count);
+	end = clock();
+	auto spent_1 = end - start;
+	_out << "core::map spent clocks: " << spent_1 << std::endl;
+
+	start = clock();
+	_test_ordered_map_performance<btree_map<int, int>>(test_count);
+	end = clock();
+	auto spent_2 = end - start;
+	_out << "core::btree_map spent clocks: " << spent_2 << std::endl;
+
+	_out << "btree_map diff to std::map = " << spent_2 - spent_0;
+	_out << ", spent percent = " << std::setiosflags(std::ios::fixed) << std::setprecision(2) << spent_2 * 100.0 / spent_0 << "%" << std::endl;
+	_out << "btree_map diff to core::map = " << spent_2 - spent_1;
+	_out << ", spent percent = " << std::setiosflags(std::ios::fixed) << std::setprecision(2) << spent_2 * 100.0 / spent_1 << "%" << std::endl;
+}
+
+CORE_NAMESPACE_END
@@ -0,0 +1,34 @@
+
+#ifndef TEST_CONTAINERS_H
+#define TEST_CONTAINERS_H
+
+#include "core.h"
+#include <ostream>
+
+CORE_NAMESPACE_BEG
+
+class test_containers {
+	std::ostream& _out;
+
+public:
+	explicit test_containers(std::ostream& out) : _out(out) {}
+
+public:
+	bool test_flat_hash_map();
+	bool test_small_vector();
+	bool test_btree_map();
+	bool test_concurrent_queue();
+	bool test_intrusive_containers();
+	bool test_hive();
+	bool test_realloc_vector();
+	bool test_atom_table();
+
+public:
+	void test_hash_map_performance();
+	void test_ordered_map_performance();
+	void test_vector_growth_performance();
+};
+
+CORE_NAMESPACE_END
+
+#endif
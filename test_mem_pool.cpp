@@ -1,5 +1,8 @@
 #include "test_mem_pool.h"
 #include "mem_pool.h"
+#include "containers.h"
+#include "frame_arena.h"
+#include "mem_pool_resource.h"
 #ifdef TEST_GC
 #include "gc/gc.h"
 #endif
@@ -70,14 +73,7 @@ bool test_mem_pool::test_alloc()
 
 	// check block increase
 	auto pool_index = mem_pool::info_for_type<int>::pool_index;
-	if (nullptr == raw_pools[pool_index])
-	{
-		_out << console_text::RED;
-		_out << "test_alloc failed: raw pool[" << pool_index << "] is nullptr" << std::endl;
-		_out << console_text::RESET;
-		return false;
-	}
-	auto& raw_pool = *raw_pools[pool_index];
+	auto& raw_pool = raw_pools[pool_index];
 	auto cell_count_in_block = mem_pool::info_for_type<int>::cell_count_in_block;
 	auto block_count = raw_pool._blocks.size();
 	if (0 != block_count)
@@ -146,6 +142,7 @@ bool test_mem_pool::test_realloc()
 			return false;
 		}
 	}
+	memset(mem, 0x5A, min_size);
 	auto new_size = min_size + 1;
 	auto new_mem = pool.realloc(mem, new_size);
 	if (new_mem == mem)
@@ -155,7 +152,18 @@ bool test_mem_pool::test_realloc()
 		_out << console_text::RESET;
 		return false;
 	}
+	auto_free.Remove(mem);
 	auto_free.Add(new_mem);
+	for (size_t i = 0; i < min_size; ++i)
+	{
+		if (0x5A != static_cast<unsigned char*>(new_mem)[i])
+		{
+			_out << console_text::RED;
+			_out << "test_realloc failed: content is not copied, offset = " << i << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+	}
 
 	_out << "test_realloc: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
 
@@ -169,7 +177,7 @@ bool test_mem_pool::test_free()
 
 	auto& raw_pools = pool._pools;
 	auto pool_index = mem_pool::info_for_type<int>::pool_index;
-	auto& raw_pool = *raw_pools[pool_index];
+	auto& raw_pool = raw_pools[pool_index];
 	auto cell_count_in_block = mem_pool::info_for_type<int>::cell_count_in_block;
 
 	auto free_cell_count = _get_free_cell_count(raw_pool);
@@ -240,7 +248,7 @@ bool test_mem_pool::test_cleanup_step()
 
 	auto& raw_pools = pool._pools;
 	auto pool_index = mem_pool::info_for_type<int>::pool_index;
-	auto& raw_pool = *raw_pools[pool_index];
+	auto& raw_pool = raw_pools[pool_index];
 	auto cell_count_in_block = mem_pool::info_for_type<int>::cell_count_in_block;
 
 	// check block count
@@ -343,6 +351,387 @@ bool test_mem_pool::test_cleanup_step()
 	return true;
 }
 
+bool test_mem_pool::test_free_batch()
+{
+	mem_pool pool;
+
+	auto& raw_pool = pool._pools[mem_pool::info_for_type<int>::pool_index];
+	auto cell_count_in_block = mem_pool::info_for_type<int>::cell_count_in_block;
+
+	// one full block, two cells of a second block, and a cell of another pool
+	std::vector<void*> mems;
+	for (size_t i = 0; i < cell_count_in_block + 2; ++i)
+	{
+		mems.push_back(pool.alloc<int>());
+	}
+	auto large_mem = pool.alloc<_LargeData>();
+	auto kept_mem = pool.alloc<int>();
+	mems.push_back(large_mem);
+	std::reverse(mems.begin(), mems.end());
+
+	auto p_mem_freed = pool.get_pool_mem_freed_ptr(mems.back());
+	auto released_count = pool.free_batch(mems.data(), mems.size());
+	auto block_count = raw_pool._blocks.size();
+	if (1 != released_count || 1 != block_count || nullptr == p_mem_freed || !*p_mem_freed)
+	{
+		_out << console_text::RED;
+		_out << "test_free_batch failed: released " << released_count << " blocks, " << block_count << " left" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_free_batch check block release: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	auto free_cell_count = _get_free_cell_count(raw_pool);
+	if (cell_count_in_block - 1 != free_cell_count)
+	{
+		_out << console_text::RED;
+		_out << "test_free_batch failed: free_cell_count is not " << cell_count_in_block - 1 << ", it is " << free_cell_count << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	pool.free(kept_mem);
+	_out << "test_free_batch check free cell count: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+bool test_mem_pool::test_typed_pool()
+{
+	mem_pool pool;
+	_AutoFree auto_free(pool);
+
+	auto& raw_pools = pool._pools;
+	auto pool_index = mem_pool::info_for_type<_LargeData>::pool_index;
+	auto& raw_pool = raw_pools[pool_index];
+	auto cell_count_in_block = mem_pool::info_for_type<_LargeData>::cell_count_in_block;
+	auto typed_pool = pool.get_typed_pool<_LargeData>();
+
+	// check typed alloc shares the raw pool
+	auto mem = typed_pool.alloc();
+	if (pool_index != static_cast<size_t>(mem_cell::get_cell(mem).head))
+	{
+		_out << console_text::RED;
+		_out << "test_typed_pool failed: cell head is not " << pool_index << ", it is " << static_cast<size_t>(mem_cell::get_cell(mem).head) << std::endl;
+		_out << console_text::RESET;
+		typed_pool.free(mem);
+		return false;
+	}
+	auto free_cell_count = _get_free_cell_count(raw_pool);
+	if (cell_count_in_block - 1 != free_cell_count)
+	{
+		_out << console_text::RED;
+		_out << "test_typed_pool failed: free_cell_count is not " << cell_count_in_block - 1 << ", it is " << free_cell_count << std::endl;
+		_out << console_text::RESET;
+		typed_pool.free(mem);
+		return false;
+	}
+	_out << "test_typed_pool check alloc: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check typed free and generic free are interchangeable
+	typed_pool.free(mem);
+	auto_free.Add(pool.alloc(sizeof(_LargeData)));
+	free_cell_count = _get_free_cell_count(raw_pool);
+	if (cell_count_in_block - 1 != free_cell_count)
+	{
+		_out << console_text::RED;
+		_out << "test_typed_pool failed: free_cell_count is not " << cell_count_in_block - 1 << ", it is " << free_cell_count << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	auto_free.Clear();
+	free_cell_count = _get_free_cell_count(raw_pool);
+	if (cell_count_in_block != free_cell_count)
+	{
+		_out << console_text::RED;
+		_out << "test_typed_pool failed: free_cell_count is not " << cell_count_in_block << ", it is " << free_cell_count << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_typed_pool check free: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+bool test_mem_pool::test_format()
+{
+	struct _case {
+		size_t value;
+		const char* size_text;
+		const char* count_text;
+	};
+	const _case cases[] = {
+		{ 0, "0", "0" },
+		{ 100, "100B", "100" },
+		{ 1024, "1K(1024)", "1,024" },
+		{ 1048, "1K24B(1048)", "1,048" },
+		{ 1000005, "976K581B(1000005)", "1,000,005" },
+		{ 3 * 1024 * 1024 * 1024ull + 5, "3G5B(3221225477)", "3,221,225,477" },
+	};
+
+	// buffer variants match the stream ones
+	for (auto& c : cases)
+	{
+		char buf[string_format_utils::FormatBufferSize];
+		auto size_length = string_format_utils::format_size(buf, sizeof(buf), c.value);
+		std::string size_text(buf, size_length);
+		auto count_length = string_format_utils::format_count(buf, sizeof(buf), c.value);
+		std::string count_text(buf, count_length);
+		if (c.size_text != size_text || c.count_text != count_text || c.size_text != string_format_utils::format_size(c.value))
+		{
+			_out << console_text::RED;
+			_out << "test_format failed: " << c.value << " is formatted as " << size_text << " and " << count_text << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+	}
+	_out << "test_format check buffer: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// a short buffer cuts the text and stays null terminated
+	char short_buf[4];
+	if (3 != string_format_utils::format_count(short_buf, sizeof(short_buf), 1234567) || std::string("1,2") != short_buf)
+	{
+		_out << console_text::RED;
+		_out << "test_format failed: short buffer holds " << short_buf << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_format check short buffer: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+bool test_mem_pool::test_frame_arena()
+{
+	const size_t block_size = 1024;
+	const size_t alloc_size = 256;
+	const size_t alloc_count = 10;
+	frame_arena arena(block_size);
+
+	// check allocations fill blocks in order
+	void* mems[alloc_count];
+	for (size_t i = 0; i < alloc_count; ++i)
+	{
+		mems[i] = arena.alloc(alloc_size);
+	}
+	if (static_cast<char*>(mems[0]) + alloc_size != mems[1] || alloc_size * alloc_count > arena.get_used_size())
+	{
+		_out << console_text::RED;
+		_out << "test_frame_arena failed: used size is " << arena.get_used_size() << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_frame_arena check alloc: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check reset drops everything but keeps the blocks
+	auto used_size = arena.get_used_size();
+	auto reserved_size = arena.get_reserved_size();
+	arena.reset();
+	if (0 != arena.get_used_size() || used_size != arena.get_high_water_size() || reserved_size != arena.get_reserved_size())
+	{
+		_out << console_text::RED;
+		_out << "test_frame_arena failed: after reset used size is " << arena.get_used_size() << ", high water size is " << arena.get_high_water_size() << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	for (size_t i = 0; i < alloc_count; ++i)
+	{
+		if (mems[i] != arena.alloc(alloc_size))
+		{
+			_out << console_text::RED;
+			_out << "test_frame_arena failed: alloc " << i << " does not reuse its block after reset" << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+	}
+	if (reserved_size != arena.get_reserved_size())
+	{
+		_out << console_text::RED;
+		_out << "test_frame_arena failed: reserved size grows from " << reserved_size << " to " << arena.get_reserved_size() << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_frame_arena check reset: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+bool test_mem_pool::test_scoped_arena()
+{
+	const size_t block_size = 1024;
+	const size_t alloc_size = 256;
+	frame_arena arena(block_size);
+	arena.alloc(alloc_size);
+	auto used_size = arena.get_used_size();
+
+	// check a scope rewinds its allocations, also across blocks
+	void* first_mem = nullptr;
+	{
+		scoped_arena scope(arena);
+		first_mem = scope.alloc(alloc_size);
+		for (size_t i = 0; i < 8; ++i)
+		{
+			scope.alloc(alloc_size);
+		}
+		if (alloc_size * 9 > scope.get_used_size())
+		{
+			_out << console_text::RED;
+			_out << "test_scoped_arena failed: scope used size is " << scope.get_used_size() << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+	}
+	if (used_size != arena.get_used_size())
+	{
+		_out << console_text::RED;
+		_out << "test_scoped_arena failed: used size is not " << used_size << " after the scope, it is " << arena.get_used_size() << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	if (first_mem != arena.alloc(alloc_size))
+	{
+		_out << console_text::RED;
+		_out << "test_scoped_arena failed: memory of the scope is not reused" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_scoped_arena check rewind: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check nested scopes rewind to their own markers
+	used_size = arena.get_used_size();
+	{
+		scoped_arena outer(arena);
+		outer.alloc(alloc_size);
+		auto outer_used_size = arena.get_used_size();
+		{
+			scoped_arena inner(arena);
+			inner.alloc(alloc_size * 3);
+			inner.alloc(alloc_size * 3);
+		}
+		if (outer_used_size != arena.get_used_size() || alloc_size != outer.get_used_size())
+		{
+			_out << console_text::RED;
+			_out << "test_scoped_arena failed: used size is not " << outer_used_size << " after the inner scope, it is " << arena.get_used_size() << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+	}
+	if (used_size != arena.get_used_size())
+	{
+		_out << console_text::RED;
+		_out << "test_scoped_arena failed: used size is not " << used_size << " after the outer scope, it is " << arena.get_used_size() << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_scoped_arena check nested: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+// upstream that counts what the pool resource hands over to it
+class _counting_resource final : public std::pmr::memory_resource {
+public:
+	size_t alloc_count = 0;
+	size_t free_count = 0;
+
+protected:
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		++alloc_count;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override
+	{
+		++free_count;
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+bool test_mem_pool::test_mem_pool_resource()
+{
+	mem_pool pool;
+	_counting_resource upstream;
+	mem_pool_resource resource(pool, &upstream);
+	auto used_cell_count = [&pool]()
+	{
+		size_t count = 0;
+		for (auto& raw_pool : pool._pools)
+		{
+			count += raw_pool._blocks.size() * raw_pool._cell_count - _get_free_cell_count(raw_pool);
+		}
+		return count;
+	};
+
+	// check small nodes come from the pool and go back to it
+	const int test_count = 100;
+	{
+		pmr::list<int> l(&resource);
+		for (int i = 0; i < test_count; ++i)
+		{
+			l.push_back(i);
+		}
+		if (static_cast<size_t>(test_count) > used_cell_count() || 0 != upstream.alloc_count)
+		{
+			_out << console_text::RED;
+			_out << "test_mem_pool_resource failed: pool holds " << used_cell_count() << " cells, upstream served " << upstream.alloc_count << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+	}
+	if (0 != used_cell_count())
+	{
+		_out << console_text::RED;
+		_out << "test_mem_pool_resource failed: " << used_cell_count() << " cells are not freed" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_mem_pool_resource check pool: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check requests too large for the pool go upstream
+	{
+		pmr::vector<char> v(&resource);
+		v.reserve(mem_pool::info_for_global::max_cell_user_mem_size + 1);
+		if (1 != upstream.alloc_count || 0 != used_cell_count())
+		{
+			_out << console_text::RED;
+			_out << "test_mem_pool_resource failed: upstream served " << upstream.alloc_count << ", pool holds " << used_cell_count() << " cells" << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+	}
+	if (1 != upstream.free_count)
+	{
+		_out << console_text::RED;
+		_out << "test_mem_pool_resource failed: upstream freed " << upstream.free_count << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_mem_pool_resource check upstream: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check frame_arena_resource allocates from the arena until reset
+	frame_arena arena(1024);
+	{
+		frame_arena_resource arena_resource(arena);
+		pmr::vector<int> v(&arena_resource);
+		v.assign(64, 1);
+		if (sizeof(int) * 64 > arena.get_used_size())
+		{
+			_out << console_text::RED;
+			_out << "test_mem_pool_resource failed: arena used size is " << arena.get_used_size() << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+	}
+	arena.reset();
+	if (0 != arena.get_used_size())
+	{
+		_out << console_text::RED;
+		_out << "test_mem_pool_resource failed: arena used size is " << arena.get_used_size() << " after reset" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_mem_pool_resource check arena: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
 void _test_new_performance(size_t test_count)
 {
 	for (size_t i = 0; i < test_count; i++)
@@ -372,6 +761,16 @@ void _test_template_alloc_performance(mem_pool& mp, size_t test_count)
 	}
 }
 
+void _test_typed_pool_alloc_performance(mem_pool& mp, size_t test_count)
+{
+	auto typed_pool = mp.get_typed_pool<int>();
+	for (size_t i = 0; i < test_count; i++)
+	{
+		auto p = typed_pool.alloc();
+		//typed_pool.free(p);
+	}
+}
+
 void _test_alloc_performance(mem_pool& mp, size_t test_count)
 {
 	for (size_t i = 0; i < test_count; i++)
@@ -381,6 +780,14 @@ void _test_alloc_performance(mem_pool& mp, size_t test_count)
 	}
 }
 
+void _test_construct_performance(size_t test_count)
+{
+	for (size_t i = 0; i < test_count; i++)
+	{
+		mem_pool mp;
+	}
+}
+
 void test_mem_pool::test_performance()
 {
 #ifdef TEST_GC
@@ -414,6 +821,12 @@ void test_mem_pool::test_performance()
 	auto spent_2 = end - start;
 	_out << "template alloc spent clocks: " << spent_2 << std::endl;
 
+	start = clock();
+	_test_typed_pool_alloc_performance(mp, test_count);
+	end = clock();
+	auto spent_4 = end - start;
+	_out << "typed pool alloc spent clocks: " << spent_4 << std::endl;
+
 	start = clock();
 	_test_alloc_performance(mp, test_count);
 	end = clock();
@@ -431,11 +844,93 @@ void test_mem_pool::test_performance()
 	_out << "template alloc diff to alloc = " << spent_2 - spent_3;
 	_out << ", spent percent = " << std::setiosflags(std::ios::fixed) << std::setprecision(2) << spent_2 * 100.0 / spent_3 << "%" << std::endl;
 
+	_out << "typed pool alloc diff to alloc = " << spent_4 - spent_3;
+	_out << ", spent percent = " << std::setiosflags(std::ios::fixed) << std::setprecision(2) << spent_4 * 100.0 / spent_3 << "%" << std::endl;
+
+	size_t construct_count = 10000;
+	start = clock();
+	_test_construct_performance(construct_count);
+	end = clock();
+	_out << "construct " << string_format_utils::format_count(construct_count) << " pools spent clocks: " << end - start << std::endl;
+
 #ifdef TEST_GC
 	GC_deinit();
 #endif // TEST_GC
 }
 
+// core::allocator before the single node fast path, every allocate goes through the size-dispatched pool path
+template<typename _T>
+struct _generic_pool_allocator {
+	using value_type = _T;
+
+	_generic_pool_allocator() = default;
+	template<typename _U>
+	_generic_pool_allocator(const _generic_pool_allocator<_U>&) noexcept {}
+
+	_T* allocate(size_t count) { return static_cast<_T*>(mem_pool_utils::alloc(sizeof(_T) * count)); }
+	void deallocate(_T* p, size_t) { mem_pool_utils::free(p); }
+};
+template <class _T, class _P>
+inline bool operator==(const _generic_pool_allocator<_T>&, const _generic_pool_allocator<_P>&) noexcept { return true; }
+template <class _T, class _P>
+inline bool operator!=(const _generic_pool_allocator<_T>&, const _generic_pool_allocator<_P>&) noexcept { return false; }
+
+// each run gets a fresh pool, so free link order left by a previous run doesn't skew the result
+template<typename _M>
+void _test_map_performance(size_t test_count)
+{
+	mem_pool mp;
+	auto p_prev_mem_pool = mem_pool_utils::p_mem_pool;
+	mem_pool_utils::p_mem_pool = &mp;
+
+	_M m;
+	for (size_t i = 0; i < test_count; i++)
+	{
+		m.emplace(static_cast<int>((i * 7919) % test_count), static_cast<int>(i));
+	}
+	for (size_t i = 0; i < test_count; i += 2)
+	{
+		m.erase(static_cast<int>(i));
+	}
+	for (size_t i = 0; i < test_count; i += 2)
+	{
+		m.emplace(static_cast<int>(i), static_cast<int>(i));
+	}
+	m.clear();
+
+	mem_pool_utils::p_mem_pool = p_prev_mem_pool;
+}
+
+void test_mem_pool::test_allocator_performance()
+{
+	clock_t start, end;
+	size_t test_count = 10000 * 100;
+	_out << "test_count: " << string_format_utils::format_count(test_count) << std::endl;
+
+	start = clock();
+	_test_map_performance<std::map<int, int>>(test_count);
+	end = clock();
+	auto spent_0 = end - start;
+	_out << "std::allocator map spent clocks: " << spent_0 << std::endl;
+
+	start = clock();
+	_test_map_performance<std::map<int, int, std::less<int>, _generic_pool_allocator<std::pair<const int, int>>>>(test_count);
+	end = clock();
+	auto spent_1 = end - start;
+	_out << "generic pool allocator map spent clocks: " << spent_1 << std::endl;
+
+	start = clock();
+	_test_map_performance<map<int, int>>(test_count);
+	end = clock();
+	auto spent_2 = end - start;
+	_out << "core::allocator map spent clocks: " << spent_2 << std::endl;
+
+	_out << "core::allocator diff to std::allocator = " << spent_2 - spent_0;
+	_out << ", spent percent = " << std::setiosflags(std::ios::fixed) << std::setprecision(2) << spent_2 * 100.0 / spent_0 << "%" << std::endl;
+	_out << "core::allocator diff to generic pool allocator = " << spent_2 - spent_1;
+	_out << ", spent percent = " << std::setiosflags(std::ios::fixed) << std::setprecision(2) << spent_2 * 100.0 / spent_1 << "%" << std::endl;
+}
+
 size_t test_mem_pool::_get_free_cell_count(const mem_raw_pool& raw_pool)
 {
 	size_t free_cell_count = 0;
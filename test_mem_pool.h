@@ -20,9 +20,16 @@ public:
 	bool test_realloc();
 	bool test_free();
 	bool test_cleanup_step();
+	bool test_free_batch();
+	bool test_typed_pool();
+	bool test_format();
+	bool test_frame_arena();
+	bool test_scoped_arena();
+	bool test_mem_pool_resource();
 
 public:
 	void test_performance();
+	void test_allocator_performance();
 
 private:
 	static size_t _get_free_cell_count(const mem_raw_pool& raw_pool);
@@ -0,0 +1,1032 @@
+#include "test_object_factory.h"
+#include "object_factory.h"
+#include "environment.h"
+#include "thread_environment.h"
+#include "general_environment.h"
+#include "bug_reporter.h"
+#include "object_handle_table.h"
+#include "object_manager.h"
+#include "object_manager_without_id.h"
+#include "object_ref_utils.h"
+#include "utils.h"
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+#include <typeinfo>
+#include <memory>
+
+CORE_NAMESPACE_BEG
+
+// counts its live instances, so tests see exactly when the factory ran destructors
+class _test_obj : public object, public support_weak_ref {
+	static std::atomic<size_t> _s_live_count;
+
+public:
+	int value;
+
+	explicit _test_obj(int v) : value(v) { _s_live_count.fetch_add(1, std::memory_order_relaxed); }
+	virtual ~_test_obj() { _s_live_count.fetch_sub(1, std::memory_order_relaxed); }
+	// object hides its operator delete, the deleting destructor still needs one
+	void operator delete(void*) {}
+
+	inline static size_t get_live_count() { return _s_live_count.load(std::memory_order_relaxed); }
+};
+
+std::atomic<size_t> _test_obj::_s_live_count(0);
+
+// current while it lives and counts the bugs reported instead of printing them
+class _bug_counting_environment : public general_environment {
+	struct _counting_bug_reporter : public bug_reporter {
+		size_t count = 0;
+
+		virtual void report(int, const char*) override { ++count; }
+	};
+
+	environment& _prev_env;
+
+public:
+	explicit _bug_counting_environment(environment& prev_env = environment::get_current_env())
+		: general_environment(new _counting_bug_reporter(), prev_env)
+		, _prev_env(prev_env)
+	{
+
+	}
+	virtual ~_bug_counting_environment() { _s_current_env = &_prev_env; }
+
+public:
+	inline size_t get_bug_count() { return static_cast<_counting_bug_reporter&>(get_bug_reporter()).count; }
+};
+
+// moves with compact_step(), on_relocated() fixes the pointer it keeps to itself
+class _test_relocate_obj : public _test_obj, public support_relocate {
+public:
+	_test_relocate_obj* p_self;
+
+	explicit _test_relocate_obj(int v) : _test_obj(v), p_self(this) {}
+	void operator delete(void*) {}
+
+protected:
+	virtual void on_relocated(const support_relocate*) override { p_self = this; }
+};
+
+class _test_hooked_relocate_obj : public _test_relocate_obj, public support_manager_hook {
+public:
+	explicit _test_hooked_relocate_obj(int v) : _test_relocate_obj(v) {}
+	void operator delete(void*) {}
+};
+
+// its constructor throws for one value, in the third chunk of a batch
+class _test_throwing_obj : public _test_relocate_obj {
+public:
+	static const int ThrowValue = 150;
+
+	explicit _test_throwing_obj(int v) : _test_relocate_obj(v)
+	{
+		if (ThrowValue == v)
+		{
+			throw std::runtime_error("_test_throwing_obj");
+		}
+	}
+	void operator delete(void*) {}
+};
+
+// two registered siblings under a registered base, and an unregistered subclass of one
+class _test_type_base : public _test_obj {
+	OBJECT_TYPE_INFO(_test_type_base, object)
+public:
+	explicit _test_type_base(int v) : _test_obj(v) {}
+	void operator delete(void*) {}
+};
+
+class _test_type_left : public _test_type_base {
+	OBJECT_TYPE_INFO(_test_type_left, _test_type_base)
+public:
+	explicit _test_type_left(int v) : _test_type_base(v) {}
+	void operator delete(void*) {}
+};
+
+class _test_type_right : public _test_type_base {
+	OBJECT_TYPE_INFO(_test_type_right, _test_type_base)
+public:
+	explicit _test_type_right(int v) : _test_type_base(v) {}
+	void operator delete(void*) {}
+};
+
+class _test_type_unregistered : public _test_type_left {
+public:
+	explicit _test_type_unregistered(int v) : _test_type_left(v) {}
+	void operator delete(void*) {}
+};
+
+// a bare weak ref target for the handle table, not created by a factory
+class _test_handle_owner : public support_weak_ref {
+};
+
+bool test_object_factory::test_thread_scope()
+{
+	const size_t thread_count = 4;
+	const size_t obj_count = 3000;
+	auto& factory = environment::get_cur_object_factory();
+	factory.on_frame_end();
+	auto live_count = _test_obj::get_live_count();
+
+	// check workers create, delay delete, delete immediately and take refs at the same time, each through its own context
+	std::vector<_test_obj*> survivors[thread_count];
+	std::atomic<size_t> error_count(0);
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < thread_count; ++t)
+	{
+		threads.emplace_back([&, t]()
+		{
+			object_factory::thread_scope scope(factory);
+			for (size_t i = 0; i < obj_count; ++i)
+			{
+				auto p = factory.new_obj<_test_obj>(static_cast<int>(i));
+				if (nullptr == p)
+				{
+					error_count.fetch_add(1, std::memory_order_relaxed);
+					continue;
+				}
+				switch (i % 3)
+				{
+				case 0:
+					if (nullptr == factory.get_weak_ref(p))
+					{
+						error_count.fetch_add(1, std::memory_order_relaxed);
+					}
+					factory.delete_obj(p);
+					break;
+				case 1:
+					factory.delete_obj_immediately(p);
+					break;
+				default:
+					if (static_cast<int>(i) != factory.get_temp_ref(p)->value)
+					{
+						error_count.fetch_add(1, std::memory_order_relaxed);
+					}
+					survivors[t].push_back(p);
+					break;
+				}
+			}
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	if (0 != error_count.load())
+	{
+		_out << console_text::RED;
+		_out << "test_thread_scope failed: " << error_count.load() << " objects are not created or reached" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_thread_scope check create: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check on_frame_end destroys what the workers delayed and nothing else
+	factory.on_frame_end();
+	size_t survivor_count = 0;
+	for (auto& objs : survivors)
+	{
+		survivor_count += objs.size();
+	}
+	if (live_count + survivor_count != _test_obj::get_live_count())
+	{
+		_out << console_text::RED;
+		_out << "test_thread_scope failed: " << _test_obj::get_live_count() - live_count << " objects live, expected " << survivor_count << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_thread_scope check merge: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check the owner thread destroys objects the workers created
+	for (auto& objs : survivors)
+	{
+		for (auto p : objs)
+		{
+			factory.delete_obj(p);
+		}
+	}
+	factory.on_frame_end();
+	if (live_count != _test_obj::get_live_count())
+	{
+		_out << console_text::RED;
+		_out << "test_thread_scope failed: " << _test_obj::get_live_count() - live_count << " objects still live" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_thread_scope check destroy: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+bool test_object_factory::test_thread_environment()
+{
+	auto& prev_env = environment::get_current_env();
+	auto live_count = _test_obj::get_live_count();
+
+	// check a thread_environment is current with a factory of its own while it lives
+	{
+		thread_environment env;
+		auto& factory = environment::get_cur_object_factory();
+		if (&env != &environment::get_current_env() || &prev_env.get_object_factory() == &factory)
+		{
+			_out << console_text::RED;
+			_out << "test_thread_environment failed: the new environment is not current" << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+		// left delayed, the factory destroys it on the way out
+		factory.delete_obj(factory.new_obj<_test_obj>(0));
+	}
+	if (&prev_env != &environment::get_current_env() || live_count != _test_obj::get_live_count())
+	{
+		_out << console_text::RED;
+		_out << "test_thread_environment failed: the previous environment is not restored or objects leak" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_thread_environment check restore: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+#if ENABLE_THREAD_LOCAL_ENVIRONMENT
+	// check threads run their own environments, factories and container pools in parallel
+	const size_t thread_count = 4;
+	const size_t obj_count = 1000;
+	environment* envs[thread_count];
+	object_factory* factories[thread_count];
+	mem_pool* pools[thread_count];
+	mem_pool* pools_after[thread_count];
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < thread_count; ++t)
+	{
+		threads.emplace_back([&, t]()
+		{
+			{
+				thread_environment env;
+				auto& factory = environment::get_cur_object_factory();
+				envs[t] = &environment::get_current_env();
+				factories[t] = &factory;
+				pools[t] = mem_pool_utils::p_mem_pool;
+				std::vector<_test_obj*> objs;
+				for (size_t i = 0; i < obj_count; ++i)
+				{
+					objs.push_back(factory.new_obj<_test_obj>(static_cast<int>(i)));
+				}
+				for (auto p : objs)
+				{
+					factory.delete_obj(p);
+				}
+				factory.on_frame_end();
+			}
+			pools_after[t] = mem_pool_utils::p_mem_pool;
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	for (size_t t = 0; t < thread_count; ++t)
+	{
+		for (size_t other = 0; other < t; ++other)
+		{
+			if (envs[other] == envs[t] || factories[other] == factories[t] || pools[other] == pools[t])
+			{
+				_out << console_text::RED;
+				_out << "test_thread_environment failed: threads " << other << " and " << t << " share an environment" << std::endl;
+				_out << console_text::RESET;
+				return false;
+			}
+		}
+		if (nullptr == pools[t] || nullptr != pools_after[t])
+		{
+			_out << console_text::RED;
+			_out << "test_thread_environment failed: thread " << t << " has no pool or keeps a dead one" << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+	}
+	if (live_count != _test_obj::get_live_count())
+	{
+		_out << console_text::RED;
+		_out << "test_thread_environment failed: " << _test_obj::get_live_count() - live_count << " objects leak" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_thread_environment check parallel: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+#endif // ENABLE_THREAD_LOCAL_ENVIRONMENT
+	return true;
+}
+
+bool test_object_factory::test_destroy_budget()
+{
+	const size_t obj_count = 10;
+	auto& factory = environment::get_cur_object_factory();
+	factory.on_frame_end();
+	auto live_count = _test_obj::get_live_count();
+
+	// check weak refs go null on delete, before any frame gets to the destructors
+	factory.set_destroy_budget(1);
+	std::vector<object_weak_ref<_test_obj>> weak_refs;
+	for (size_t i = 0; i < obj_count; ++i)
+	{
+		auto p = factory.new_obj<_test_obj>(static_cast<int>(i));
+		weak_refs.push_back(factory.get_weak_ref(p));
+		factory.delete_obj(p);
+	}
+	for (auto& weak_ref : weak_refs)
+	{
+		if (nullptr != weak_ref)
+		{
+			factory.flush_delay_destroy();
+			factory.set_destroy_budget(0);
+			_out << console_text::RED;
+			_out << "test_destroy_budget failed: weak ref of a deleted object is not null" << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+	}
+	_out << "test_destroy_budget check weak ref: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check the same through a manager, which deletes by object pointer
+	{
+		object_manager<int, _test_obj> manager(factory);
+		auto w_ref = manager.create(0);
+		manager.destroy(0);
+		if (nullptr != w_ref)
+		{
+			factory.flush_delay_destroy();
+			factory.set_destroy_budget(0);
+			_out << console_text::RED;
+			_out << "test_destroy_budget failed: weak ref of an object destroyed by its manager is not null" << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+	}
+	_out << "test_destroy_budget check manager weak ref: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	factory.flush_delay_destroy();
+
+	// check one frame destroys one object and carries the rest over
+	for (size_t i = 0; i < obj_count; ++i)
+	{
+		factory.delete_obj(factory.new_obj<_test_obj>(static_cast<int>(i)));
+	}
+	factory.on_frame_end();
+	auto pending_count = factory.get_pending_destroy_count();
+	auto frame_live_count = _test_obj::get_live_count();
+	factory.flush_delay_destroy();
+	factory.set_destroy_budget(0);
+	if (obj_count - 1 != pending_count || live_count + obj_count - 1 != frame_live_count)
+	{
+		_out << console_text::RED;
+		_out << "test_destroy_budget failed: " << pending_count << " objects pending after one frame" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	if (live_count != _test_obj::get_live_count())
+	{
+		_out << console_text::RED;
+		_out << "test_destroy_budget failed: flush leaves " << _test_obj::get_live_count() - live_count << " objects" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_destroy_budget check budget: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+bool test_object_factory::test_handle_table()
+{
+	_test_handle_owner owner1;
+	_test_handle_owner owner2;
+
+	// check a released handle goes stale and its slot comes back with a new generation
+	auto handle1 = object_handle_table::acquire(&owner1);
+	if (&owner1 != object_handle_table::resolve(handle1))
+	{
+		_out << console_text::RED;
+		_out << "test_handle_table failed: a new handle does not resolve to its object" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	object_handle_table::release(handle1);
+	auto handle2 = object_handle_table::acquire(&owner2);
+	if (nullptr != object_handle_table::resolve(handle1) || &owner2 != object_handle_table::resolve(handle2)
+		|| static_cast<uint32_t>(handle1) != static_cast<uint32_t>(handle2) || handle1 == handle2)
+	{
+		_out << console_text::RED;
+		_out << "test_handle_table failed: a stale handle resolves or its slot is not reused" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_handle_table check release: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check rebind moves a live handle and stale handles are reported, not applied
+	{
+		_bug_counting_environment env;
+		object_handle_table::rebind(handle2, &owner1);
+		auto rebound = object_handle_table::resolve(handle2);
+		object_handle_table::rebind(handle1, &owner2);
+		object_handle_table::release(handle1);
+		if (&owner1 != rebound || &owner1 != object_handle_table::resolve(handle2) || 2 != env.get_bug_count())
+		{
+			object_handle_table::release(handle2);
+			_out << console_text::RED;
+			_out << "test_handle_table failed: rebind is wrong or " << env.get_bug_count() << " stale uses reported" << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+	}
+	object_handle_table::release(handle2);
+	_out << "test_handle_table check rebind: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check a handle never resolves to the next object of its slot while another thread releases and reuses it
+	const size_t reuse_count = 100000;
+	auto handle = object_handle_table::acquire(&owner1);
+	std::atomic<bool> stop(false);
+	std::atomic<size_t> wrong_count(0);
+	std::thread reader([&]()
+	{
+		while (!stop.load(std::memory_order_relaxed))
+		{
+			auto p = object_handle_table::resolve(handle);
+			if (nullptr != p && &owner1 != p)
+			{
+				wrong_count.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+	});
+	object_handle_table::release(handle);
+	for (size_t i = 0; i < reuse_count; ++i)
+	{
+		object_handle_table::release(object_handle_table::acquire(&owner2));
+	}
+	stop.store(true, std::memory_order_relaxed);
+	reader.join();
+	if (0 != wrong_count.load())
+	{
+		_out << console_text::RED;
+		_out << "test_handle_table failed: a stale handle resolved to another object " << wrong_count.load() << " times" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_handle_table check reuse: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+bool test_object_factory::test_compact_step()
+{
+	// two blocks of objects, every tenth survives, so the blocks end up 10% used
+	const int obj_count = static_cast<int>(mem_pool::info_for_type<_test_hooked_relocate_obj>::cell_count_in_block * 2);
+	const int keep_step = 10;
+	auto live_count = _test_obj::get_live_count();
+
+#if ENABLE_MEM_POOL_CLEANUP
+	// check objects kept by object_manager move and stay reachable by id
+	{
+		object_factory factory;
+		object_manager<int, _test_relocate_obj> manager(factory);
+		for (int i = 0; i < obj_count; ++i)
+		{
+			manager.create(i);
+		}
+		std::vector<_test_relocate_obj*> old_objs;
+		for (int i = 0; i < obj_count; ++i)
+		{
+			if (0 == i % keep_step)
+			{
+				old_objs.push_back(manager.try_get(i).operator->());
+			}
+			else
+			{
+				manager.destroy_immediately(i);
+			}
+		}
+		size_t step_count = 0;
+		while (factory.compact_step())
+		{
+			++step_count;
+		}
+		size_t moved_count = 0;
+		for (int i = 0; i < obj_count; i += keep_step)
+		{
+			auto w_ref = manager.try_get(i);
+			if (nullptr == w_ref || i != w_ref->value || w_ref.operator->() != w_ref->p_self || i != manager.try_get_temp(i)->value)
+			{
+				_out << console_text::RED;
+				_out << "test_compact_step failed: object " << i << " is lost after compaction" << std::endl;
+				_out << console_text::RESET;
+				return false;
+			}
+			moved_count += old_objs[i / keep_step] != w_ref.operator->() ? 1 : 0;
+		}
+		if (0 == step_count || 0 == moved_count)
+		{
+			_out << console_text::RED;
+			_out << "test_compact_step failed: " << step_count << " blocks released, " << moved_count << " objects moved" << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+	}
+	_out << "test_compact_step check object_manager: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+#endif // ENABLE_MEM_POOL_CLEANUP
+
+	// check delay deleted objects stay where the pending list has them
+	{
+		object_factory factory;
+		factory.set_destroy_budget(1);
+		std::vector<_test_relocate_obj*> objs;
+		for (int i = 0; i < obj_count; ++i)
+		{
+			objs.push_back(factory.new_obj<_test_relocate_obj>(i));
+		}
+		for (int i = 0; i < obj_count; ++i)
+		{
+			if (0 == i % keep_step)
+			{
+				factory.delete_obj(objs[i]);
+			}
+			else
+			{
+				factory.delete_obj_immediately(objs[i]);
+			}
+		}
+		factory.on_frame_end();
+		while (factory.compact_step())
+		{
+		}
+		factory.flush_delay_destroy();
+	}
+	if (live_count != _test_obj::get_live_count())
+	{
+		_out << console_text::RED;
+		_out << "test_compact_step failed: " << _test_obj::get_live_count() - live_count << " delay deleted objects leak" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_compact_step check delay delete: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check objects linked into object_manager_without_id are pinned, their list hooks hold addresses
+	{
+		object_factory factory;
+		object_manager_without_id<_test_hooked_relocate_obj> manager(factory);
+		std::vector<object_weak_ref<_test_hooked_relocate_obj>> w_refs;
+		for (int i = 0; i < obj_count; ++i)
+		{
+			w_refs.push_back(manager.create(i));
+		}
+		for (int i = 0; i < obj_count; ++i)
+		{
+			if (0 != i % keep_step)
+			{
+				manager.destroy_immediately(w_refs[i]);
+			}
+		}
+		if (factory.compact_step())
+		{
+			_out << console_text::RED;
+			_out << "test_compact_step failed: a block of pinned objects is released" << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+		for (int i = 0; i < obj_count; i += keep_step)
+		{
+			manager.destroy_immediately(w_refs[i]);
+		}
+	}
+	if (live_count != _test_obj::get_live_count())
+	{
+		_out << console_text::RED;
+		_out << "test_compact_step failed: " << _test_obj::get_live_count() - live_count << " managed objects leak" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_compact_step check object_manager_without_id: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check relocatable objects under a base that is not are pinned, the manager keeps them by address
+	{
+		object_factory factory;
+		object_manager<int, _test_obj> manager(factory);
+		std::vector<int> batch_ids;
+		for (int i = 0; i < obj_count; ++i)
+		{
+			if (0 == i % 2)
+			{
+				manager.create<_test_relocate_obj>(i);
+			}
+			else
+			{
+				batch_ids.push_back(i);
+			}
+		}
+		manager.create_batch<_test_relocate_obj>(batch_ids.begin(), batch_ids.end());
+		for (int i = 0; i < obj_count; ++i)
+		{
+			if (0 != i % keep_step)
+			{
+				manager.destroy_immediately(i);
+			}
+		}
+		if (factory.compact_step())
+		{
+			_out << console_text::RED;
+			_out << "test_compact_step failed: a block of relocatable objects kept by a base manager is released" << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+		for (int i = 0; i < obj_count; i += keep_step)
+		{
+			auto w_ref = manager.try_get(i);
+			auto p_obj = static_cast<_test_relocate_obj*>(w_ref.operator->());
+			if (nullptr == w_ref || i != w_ref->value || p_obj != p_obj->p_self)
+			{
+				_out << console_text::RED;
+				_out << "test_compact_step failed: object " << i << " of a base manager is lost" << std::endl;
+				_out << console_text::RESET;
+				return false;
+			}
+		}
+	}
+	if (live_count != _test_obj::get_live_count())
+	{
+		_out << console_text::RED;
+		_out << "test_compact_step failed: " << _test_obj::get_live_count() - live_count << " objects of a base manager leak" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_compact_step check base object_manager: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+bool test_object_factory::test_new_objs()
+{
+	const int obj_count = 200;
+	auto& factory = environment::get_cur_object_factory();
+	auto live_count = _test_obj::get_live_count();
+
+	// check a batch skips repeated and existing ids and lands every object in the manager
+	{
+		object_manager<int, _test_obj> manager(factory);
+		manager.create(0);
+		std::vector<int> ids;
+		for (int i = obj_count - 1; i >= 0; --i)
+		{
+			ids.push_back(i);
+			ids.push_back(i);
+		}
+		auto w_refs = manager.create_batch(ids.begin(), ids.end());
+		if (static_cast<size_t>(obj_count - 1) != w_refs.size() || live_count + obj_count != _test_obj::get_live_count())
+		{
+			_out << console_text::RED;
+			_out << "test_new_objs failed: a batch of " << obj_count - 1 << " ids creates " << w_refs.size() << " objects" << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+		for (int i = 1; i < obj_count; ++i)
+		{
+			if (w_refs[i - 1] != manager.try_get(i) || i != manager.try_get(i)->value)
+			{
+				_out << console_text::RED;
+				_out << "test_new_objs failed: object " << i << " of the batch is not in the manager" << std::endl;
+				_out << console_text::RESET;
+				return false;
+			}
+		}
+	}
+	factory.on_frame_end();
+	if (live_count != _test_obj::get_live_count())
+	{
+		_out << console_text::RED;
+		_out << "test_new_objs failed: " << _test_obj::get_live_count() - live_count << " batch objects leak" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_new_objs check object_manager: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check the same for a manager without ids
+	{
+		object_manager_without_id<_test_obj> manager(factory);
+		auto w_refs = manager.create_batch(obj_count, 7);
+		if (static_cast<size_t>(obj_count) != w_refs.size())
+		{
+			_out << console_text::RED;
+			_out << "test_new_objs failed: a batch of " << obj_count << " creates " << w_refs.size() << " objects" << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+		for (auto& w_ref : w_refs)
+		{
+			manager.destroy_immediately(w_ref);
+		}
+		if (live_count != _test_obj::get_live_count())
+		{
+			_out << console_text::RED;
+			_out << "test_new_objs failed: " << _test_obj::get_live_count() - live_count << " batch objects are not in the manager" << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+	}
+	_out << "test_new_objs check object_manager_without_id: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check a constructor throwing in the middle of a batch leaves no object, handle or relocatable behind
+	{
+		object_manager<int, _test_throwing_obj> manager(factory);
+		std::vector<int> ids;
+		for (int i = 0; i < obj_count; ++i)
+		{
+			ids.push_back(i);
+		}
+		bool thrown = false;
+		try
+		{
+			manager.create_batch(ids.begin(), ids.end());
+		}
+		catch (const std::runtime_error&)
+		{
+			thrown = true;
+		}
+		if (!thrown || live_count != _test_obj::get_live_count() || !factory._relocatable_objs.empty() || nullptr != manager.try_get(0))
+		{
+			_out << console_text::RED;
+			_out << "test_new_objs failed: a throwing batch leaves " << _test_obj::get_live_count() - live_count << " objects" << std::endl;
+			_out << console_text::RESET;
+			return false;
+		}
+	}
+	_out << "test_new_objs check throw: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+bool test_object_factory::test_object_type_info()
+{
+	static_assert(cast_utils<_test_type_base, _test_type_left>::IsObjectTypeDowncast, "registered downcasts use object_type_info");
+	static_assert(!cast_utils<_test_type_base, _test_type_unregistered>::IsObjectTypeDowncast, "unregistered downcasts use dynamic_cast");
+
+	auto& factory = environment::get_cur_object_factory();
+	_test_type_base* p_left = factory.new_obj<_test_type_left>(1);
+	_test_type_base* p_right = factory.new_obj<_test_type_right>(2);
+	_test_type_base* p_unregistered = factory.new_obj<_test_type_unregistered>(3);
+	auto destroy_objs = [&]()
+	{
+		factory.delete_obj_immediately(p_left);
+		factory.delete_obj_immediately(p_right);
+		factory.delete_obj_immediately(p_unregistered);
+	};
+
+	// check casts to the registered type of the object or one of its bases succeed
+	auto p_left_obj = cast_utils<_test_type_base, _test_type_left>::cast(p_left);
+	if (p_left != p_left_obj || p_left != cast_utils<_test_type_left, _test_type_base>::cast(p_left_obj)
+		|| p_left != cast_utils<object, _test_type_base>::cast(static_cast<object*>(p_left))
+		|| !p_left->get_type_info().is_a(object::static_type_info()))
+	{
+		destroy_objs();
+		_out << console_text::RED;
+		_out << "test_object_type_info failed: cast to a type the object is fails" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_object_type_info check cast: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check a cast to a sibling fails, through pointers, references and weak refs
+	bool bad_cast_thrown = false;
+	try
+	{
+		cast_utils<_test_type_base, _test_type_right>::cast(*p_left);
+	}
+	catch (const std::bad_cast&)
+	{
+		bad_cast_thrown = true;
+	}
+	auto left_ref = factory.get_weak_ref(p_left);
+	if (nullptr != cast_utils<_test_type_base, _test_type_right>::cast(p_left) || !bad_cast_thrown
+		|| nullptr != object_ref_utils::cast<_test_type_right>(left_ref, factory) || nullptr == object_ref_utils::cast<_test_type_left>(left_ref, factory))
+	{
+		destroy_objs();
+		_out << console_text::RED;
+		_out << "test_object_type_info failed: cast to a sibling type succeeds" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_object_type_info check cross cast: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check an unregistered type shares the type of its registered base and its own casts still work
+	if (&_test_type_left::static_type_info() != &p_unregistered->get_type_info()
+		|| p_unregistered != cast_utils<_test_type_base, _test_type_left>::cast(p_unregistered)
+		|| p_unregistered != cast_utils<_test_type_base, _test_type_unregistered>::cast(p_unregistered)
+		|| nullptr != cast_utils<_test_type_base, _test_type_unregistered>::cast(p_left))
+	{
+		destroy_objs();
+		_out << console_text::RED;
+		_out << "test_object_type_info failed: cast of an unregistered type is wrong" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_object_type_info check unregistered: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	destroy_objs();
+	return true;
+}
+
+bool test_object_factory::test_ref_policy()
+{
+	static_assert(sizeof(ref<_test_obj>) == sizeof(_test_obj*), "an unchecked ref is a bare pointer");
+	static_assert(sizeof(ref<_test_obj, object_shared_ref_checker>) == sizeof(_test_obj*), "a stateless checker costs nothing");
+
+	auto& factory = environment::get_cur_object_factory();
+	auto p_obj = factory.new_obj<_test_obj>(1);
+	size_t unchecked_bug_count = 0;
+	size_t checked_bug_count = 0;
+	size_t live_bug_count = 0;
+	{
+		_bug_counting_environment env;
+
+		// the default policy checks nothing, the shared ref policy reports null
+		ref<_test_obj> unchecked_ref(nullptr);
+		unchecked_ref.operator->();
+		unchecked_bug_count = env.get_bug_count();
+		ref<_test_obj, object_shared_ref_checker> checked_ref(nullptr);
+		checked_ref.operator->();
+		checked_bug_count = env.get_bug_count() - unchecked_bug_count;
+
+		// a live pointer passes the check, also after moving to the other policy
+		ref<_test_obj, object_shared_ref_checker> live_ref(p_obj);
+		ref<_test_obj> live_unchecked_ref(live_ref);
+		if (1 != live_ref->value || 1 != live_unchecked_ref->value || live_ref != live_unchecked_ref)
+		{
+			++live_bug_count;
+		}
+		live_bug_count += env.get_bug_count() - unchecked_bug_count - checked_bug_count;
+	}
+	factory.delete_obj_immediately(p_obj);
+
+#if ENABLE_REF_SAFE_CHECK
+	const size_t expected_checked_bug_count = 1;
+#else
+	const size_t expected_checked_bug_count = 0;
+#endif // ENABLE_REF_SAFE_CHECK
+	if (0 != unchecked_bug_count || expected_checked_bug_count != checked_bug_count || 0 != live_bug_count)
+	{
+		_out << console_text::RED;
+		_out << "test_ref_policy failed: " << unchecked_bug_count << " unchecked, " << checked_bug_count << " checked, " << live_bug_count << " live reports" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_ref_policy check policy: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+bool test_object_factory::test_temp_ref()
+{
+	auto& factory = environment::get_cur_object_factory();
+	auto p_obj = factory.new_obj<_test_obj>(1);
+	size_t valid_bug_count = 0;
+	size_t stale_bug_count = 0;
+	size_t reused_bug_count = 0;
+	size_t new_bug_count = 0;
+	bool reused = false;
+	{
+		_bug_counting_environment env;
+
+		// a temp ref to a live object passes the check
+		auto& temp_ref = factory.get_temp_ref(p_obj);
+		if (1 != temp_ref->value)
+		{
+			++valid_bug_count;
+		}
+		valid_bug_count += env.get_bug_count();
+
+		// the destroy bumps the cell generation, the stale temp ref reports without touching the object
+		factory.delete_obj_immediately(p_obj);
+		temp_ref.operator->();
+		stale_bug_count = env.get_bug_count() - valid_bug_count;
+
+		// a new object in the same cell keeps the old temp ref stale, its own temp ref is valid
+		auto p_new_obj = factory.new_obj<_test_obj>(2);
+		reused = static_cast<object*>(p_new_obj) == static_cast<object*>(p_obj);
+		temp_ref.operator->();
+		reused_bug_count = env.get_bug_count() - valid_bug_count - stale_bug_count;
+		auto& new_temp_ref = factory.get_temp_ref(p_new_obj);
+		if (2 != new_temp_ref->value)
+		{
+			++new_bug_count;
+		}
+		new_bug_count += env.get_bug_count() - valid_bug_count - stale_bug_count - reused_bug_count;
+		factory.delete_obj_immediately(p_new_obj);
+	}
+
+#if ENABLE_TEMP_REF_CHECK && CELL_GENERATION
+	const size_t expected_stale_bug_count = 1;
+#else
+	const size_t expected_stale_bug_count = 0;
+#endif // ENABLE_TEMP_REF_CHECK && CELL_GENERATION
+	if (0 != valid_bug_count || expected_stale_bug_count != stale_bug_count || 0 != new_bug_count
+		|| (reused && expected_stale_bug_count != reused_bug_count))
+	{
+		_out << console_text::RED;
+		_out << "test_temp_ref failed: " << valid_bug_count << " valid, " << stale_bug_count << " stale, "
+			<< reused_bug_count << " reused, " << new_bug_count << " new reports" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_temp_ref check generation: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check temp refs outlive a flush in the middle of the frame, enough objects to empty whole pool blocks
+	const size_t obj_count = 65536;
+	factory.on_frame_end();
+	auto p_live_obj = factory.new_obj<_test_obj>(1);
+	auto& live_temp_ref = factory.get_temp_ref(p_live_obj);
+	std::vector<object_temp_ref<_test_obj>*> flushed_temp_refs;
+	for (size_t i = 0; i < obj_count; ++i)
+	{
+		auto p = factory.new_obj<_test_obj>(static_cast<int>(i));
+		// temp refs hide operator&
+		flushed_temp_refs.push_back(std::addressof(factory.get_temp_ref(p)));
+		factory.delete_obj(p);
+	}
+	size_t live_bug_count = 0;
+	size_t flushed_bug_count = 0;
+	{
+		_bug_counting_environment env;
+		factory.flush_delay_destroy();
+		auto p_next_obj = factory.new_obj<_test_obj>(2);
+		auto& next_temp_ref = factory.get_temp_ref(p_next_obj);
+		if (1 != live_temp_ref->value || 2 != next_temp_ref->value)
+		{
+			++live_bug_count;
+		}
+		live_bug_count += env.get_bug_count();
+		for (auto p_temp_ref : flushed_temp_refs)
+		{
+			p_temp_ref->operator->();
+		}
+		flushed_bug_count = env.get_bug_count() - live_bug_count;
+		factory.delete_obj_immediately(p_next_obj);
+	}
+	factory.delete_obj_immediately(p_live_obj);
+	factory.on_frame_end();
+
+	if (0 != live_bug_count || expected_stale_bug_count * obj_count != flushed_bug_count)
+	{
+		_out << console_text::RED;
+		_out << "test_temp_ref failed: " << live_bug_count << " live, " << flushed_bug_count << " flushed reports after flush_delay_destroy" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_temp_ref check flush: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+
+	// check an upcast keeps the generation, a stale temp ref does not turn fresh
+	size_t cast_bug_count = 0;
+	size_t stale_cast_bug_count = 0;
+	{
+		_bug_counting_environment env;
+		auto p_left = factory.new_obj<_test_type_left>(3);
+		auto& left_temp_ref = factory.get_temp_ref(p_left);
+		auto& base_temp_ref = object_ref_utils::cast<_test_type_base>(left_temp_ref, factory);
+		if (3 != base_temp_ref->value)
+		{
+			++cast_bug_count;
+		}
+		cast_bug_count += env.get_bug_count();
+		factory.delete_obj_immediately(p_left);
+		auto& stale_base_temp_ref = object_ref_utils::cast<_test_type_base>(left_temp_ref, factory);
+		stale_base_temp_ref.operator->();
+		stale_cast_bug_count = env.get_bug_count() - cast_bug_count;
+	}
+	factory.on_frame_end();
+
+	if (0 != cast_bug_count || expected_stale_bug_count != stale_cast_bug_count)
+	{
+		_out << console_text::RED;
+		_out << "test_temp_ref failed: " << cast_bug_count << " live, " << stale_cast_bug_count << " stale reports after an upcast" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_temp_ref check cast: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+bool test_object_factory::test_object_manager_without_id()
+{
+	auto& factory = environment::get_cur_object_factory();
+	auto live_count = _test_obj::get_live_count();
+	size_t bug_count = 0;
+	{
+		object_manager_without_id<_test_obj> manager(factory);
+		auto w_ref = manager.create(1);
+		manager.destroy_immediately(w_ref);
+
+		// check an expired weak_ref is a no-op, not a weak ref access to report
+		_bug_counting_environment env;
+		manager.destroy(w_ref);
+		manager.destroy_immediately(w_ref);
+		bug_count = env.get_bug_count();
+	}
+	if (0 != bug_count || live_count != _test_obj::get_live_count())
+	{
+		_out << console_text::RED;
+		_out << "test_object_manager_without_id failed: destroying an expired weak_ref reported " << bug_count << " bugs" << std::endl;
+		_out << console_text::RESET;
+		return false;
+	}
+	_out << "test_object_manager_without_id check expired destroy: " << console_text::GREEN << "OK" << console_text::RESET << std::endl;
+	return true;
+}
+
+CORE_NAMESPACE_END
@@ -0,0 +1,31 @@
+
+#ifndef TEST_OBJECT_FACTORY_H
+#define TEST_OBJECT_FACTORY_H
+
+#include "core.h"
+#include <ostream>
+
+CORE_NAMESPACE_BEG
+
+class test_object_factory {
+	std::ostream& _out;
+
+public:
+	explicit test_object_factory(std::ostream& out) : _out(out) {}
+
+public:
+	bool test_thread_scope();
+	bool test_thread_environment();
+	bool test_destroy_budget();
+	bool test_handle_table();
+	bool test_compact_step();
+	bool test_new_objs();
+	bool test_object_type_info();
+	bool test_ref_policy();
+	bool test_temp_ref();
+	bool test_object_manager_without_id();
+};
+
+CORE_NAMESPACE_END
+
+#endif
@@ -0,0 +1,54 @@
+
+#ifndef THREAD_ENVIRONMENT_H
+#define THREAD_ENVIRONMENT_H
+
+#include "core.h"
+#include "environment.h"
+#include "bug_reporter.h"
+#include "object_factory.h"
+
+CORE_NAMESPACE_BEG
+
+/// <summary>
+/// environment with a bug_reporter and object_factory of its own, current from construction until destruction.
+/// with ENABLE_THREAD_LOCAL_ENVIRONMENT each thread can run one in parallel, otherwise it replaces the current environment of the process.
+/// construct and destroy on the same thread, nested ones in reverse order
+/// </summary>
+class thread_environment : public environment {
+	// first member, so the previous environment comes back only after the factory has destroyed its delayed objects
+	struct _prev_env_restorer {
+		environment* p_prev_env;
+
+		explicit _prev_env_restorer(environment* p_env) : p_prev_env(p_env) {}
+		~_prev_env_restorer() { _s_current_env = p_prev_env; }
+	};
+
+	_prev_env_restorer _restorer;
+	bug_reporter _bug_reporter;
+	object_factory _obj_factory;
+
+public:
+	// takes over from whatever is current on this thread, a thread without an environment goes back to none.
+	// the factory serves mem_pool_utils on this thread unless an earlier one already does
+	thread_environment() : thread_environment(_s_current_env) {}
+	virtual ~thread_environment() = default;
+
+private:
+	// the base constructor makes this current, the previous one is read before it runs
+	explicit thread_environment(environment* p_prev_env)
+		: environment()
+		, _restorer(p_prev_env)
+		, _bug_reporter()
+		, _obj_factory()
+	{
+
+	}
+
+public:
+	virtual bug_reporter& get_bug_reporter() override { return _bug_reporter; }
+	virtual object_factory& get_object_factory() override { return _obj_factory; }
+};
+
+CORE_NAMESPACE_END
+
+#endif
@@ -1,5 +1,7 @@
 #include "utils.h"
 #include <iomanip>
+#include <charconv>
+#include <string.h>
 
 CORE_NAMESPACE_BEG
 
@@ -37,30 +39,8 @@ size_t string_format_utils::format_size(std::stringstream& ss, size_t size, size
 
 std::string string_format_utils::format_size(size_t size)
 {
-    static const size_t B = 1;
-    static const size_t KB = 1024 * B;
-    static const size_t MB = 1024 * KB;
-    static const size_t GB = 1024 * MB;
-    if (0 == size)
-    {
-        std::stringstream ss;
-        ss << size;
-        return std::move(ss.str());
-    }
-
-    size_t origin = size;
-
-    std::stringstream ss;
-    size = size - format_size(ss, size, GB, "G");
-    size = size - format_size(ss, size, MB, "M");
-    size = size - format_size(ss, size, KB, "K");
-    format_size(ss, size, B, "B");
-
-    if (size != origin)
-    {
-        ss << "(" << origin << ")";
-    }
-    return std::move(ss.str());
+    char buf[FormatBufferSize];
+    return std::string(buf, format_size(buf, sizeof(buf), size));
 }
 
 void string_format_utils::format_count(std::stringstream& ss, size_t size)
@@ -79,9 +59,117 @@ void string_format_utils::format_count(std::stringstream& ss, size_t size)
 }
 std::string string_format_utils::format_count(size_t size)
 {
-    std::stringstream ss;
-    format_count(ss, size);
-    return std::move(ss.str());
+    char buf[FormatBufferSize];
+    return std::string(buf, format_count(buf, sizeof(buf), size));
+}
+
+// bounded writer over a caller buffer, keeps one char for the null terminator
+class _format_writer {
+    char* _beg;
+    char* _cur;
+    char* _end;
+
+public:
+    inline _format_writer(char* buf, size_t buf_size) : _beg(buf), _cur(buf), _end(buf + buf_size - 1) {}
+
+public:
+    inline void write(size_t value)
+    {
+        auto result = std::to_chars(_cur, _end, value);
+        _cur = std::errc() == result.ec ? result.ptr : _end;
+    }
+    // zero padded to width digits
+    inline void write(size_t value, size_t width)
+    {
+        char digits[24];
+        auto digits_end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        for (auto count = static_cast<size_t>(digits_end - digits); count < width; ++count)
+        {
+            write('0');
+        }
+        write(digits, static_cast<size_t>(digits_end - digits));
+    }
+    inline void write(char c)
+    {
+        if (_cur < _end)
+        {
+            *_cur++ = c;
+        }
+    }
+    inline void write(const char* s, size_t length)
+    {
+        auto free_size = static_cast<size_t>(_end - _cur);
+        length = length < free_size ? length : free_size;
+        memcpy(_cur, s, length);
+        _cur += length;
+    }
+    inline size_t finish()
+    {
+        *_cur = '\0';
+        return static_cast<size_t>(_cur - _beg);
+    }
+};
+
+size_t string_format_utils::format_size(char* buf, size_t buf_size, size_t size)
+{
+    static const size_t B = 1;
+    static const size_t KB = 1024 * B;
+    static const size_t MB = 1024 * KB;
+    static const size_t GB = 1024 * MB;
+    static const size_t units[] = { GB, MB, KB, B };
+    static const char suffixes[] = { 'G', 'M', 'K', 'B' };
+
+    _format_writer writer(buf, buf_size);
+    if (0 == size)
+    {
+        writer.write(size);
+        return writer.finish();
+    }
+
+    auto rest = size;
+    for (size_t i = 0; i < sizeof(units) / sizeof(units[0]); ++i)
+    {
+        if (units[i] <= rest)
+        {
+            writer.write(rest / units[i]);
+            writer.write(suffixes[i]);
+            // bytes are the last unit, they stay in rest like the stream version
+            if (B != units[i])
+            {
+                rest %= units[i];
+            }
+        }
+    }
+
+    if (rest != size)
+    {
+        writer.write('(');
+        writer.write(size);
+        writer.write(')');
+    }
+    return writer.finish();
+}
+
+size_t string_format_utils::format_count(char* buf, size_t buf_size, size_t size)
+{
+    static const size_t K = 1000;
+    // groups of 3 digits from the lowest, written from the highest
+    size_t groups[8];
+    size_t group_count = 0;
+    do
+    {
+        groups[group_count++] = size % K;
+        size /= K;
+    } while (0 < size);
+
+    _format_writer writer(buf, buf_size);
+    writer.write(groups[group_count - 1]);
+    for (auto i = group_count - 1; 0 < i; --i)
+    {
+        writer.write(',');
+        writer.write(groups[i - 1], 3);
+    }
+    return writer.finish();
 }
 
 CORE_NAMESPACE_END
\ No newline at end of file
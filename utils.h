@@ -5,6 +5,9 @@
 #include "core.h"
 #include <string>
 #include <sstream>
+#include <ostream>
+#include <type_traits>
+#include <typeinfo>
 
 CORE_NAMESPACE_BEG
 
@@ -32,15 +35,98 @@ struct console_text {
 };
 
 struct string_format_utils {
+	/// <summary>
+	/// fits format_size or format_count of any size_t, null terminator included
+	/// </summary>
+	static const size_t FormatBufferSize = 64;
+
 	static size_t format_size(std::stringstream& ss, size_t size, size_t formatSize, const char* suffix);
 	static std::string format_size(size_t size);
 	static void format_count(std::stringstream& ss, size_t size);
 	static std::string format_count(size_t size);
+
+	/// <summary>
+	/// writes into buf with to_chars, never allocates. the result is null terminated and cut at buf_size - 1 chars
+	/// </summary>
+	/// <returns>the number of chars written</returns>
+	static size_t format_size(char* buf, size_t buf_size, size_t size);
+	static size_t format_count(char* buf, size_t buf_size, size_t size);
+
+	/// <summary>
+	/// appends to any string with append(const char*, size_t), such as core::string
+	/// </summary>
+	template<typename _String>
+	inline static void append_size(_String& s, size_t size)
+	{
+		char buf[FormatBufferSize];
+		s.append(buf, format_size(buf, sizeof(buf), size));
+	}
+	template<typename _String>
+	inline static void append_count(_String& s, size_t size)
+	{
+		char buf[FormatBufferSize];
+		s.append(buf, format_count(buf, sizeof(buf), size));
+	}
+};
+
+/// <summary>
+/// format_size in an inline buffer, streams without allocating: out << formatted_size(size)
+/// </summary>
+class formatted_size {
+	char _buf[string_format_utils::FormatBufferSize];
+	size_t _length;
+
+public:
+	inline explicit formatted_size(size_t size) : _length(string_format_utils::format_size(_buf, sizeof(_buf), size)) {}
+
+public:
+	inline const char* c_str() const { return _buf; }
+	inline size_t length() const { return _length; }
 };
+inline std::ostream& operator<<(std::ostream& out, const formatted_size& text)
+{
+	return out.write(text.c_str(), static_cast<std::streamsize>(text.length()));
+}
+
+/// <summary>
+/// format_count in an inline buffer, streams without allocating: out << formatted_count(count)
+/// </summary>
+class formatted_count {
+	char _buf[string_format_utils::FormatBufferSize];
+	size_t _length;
+
+public:
+	inline explicit formatted_count(size_t count) : _length(string_format_utils::format_count(_buf, sizeof(_buf), count)) {}
+
+public:
+	inline const char* c_str() const { return _buf; }
+	inline size_t length() const { return _length; }
+};
+inline std::ostream& operator<<(std::ostream& out, const formatted_count& text)
+{
+	return out.write(text.c_str(), static_cast<std::streamsize>(text.length()));
+}
 
 class _cast_utils {
 protected:
-	template<typename _T, typename _P, bool _IsConvertible>
+	// _P declared with OBJECT_TYPE_INFO and _T one of its object bases: a downcast checked against object_type_info
+	template<typename _T, typename _P>
+	struct _is_object_type_downcast {
+		template<typename _U>
+		static typename std::is_same<typename _U::_object_type_self, _U>::type test_registered(int);
+		template<typename _U>
+		static std::false_type test_registered(...);
+		template<typename _U>
+		static std::true_type test_object(typename _U::_object_type_self*);
+		template<typename _U>
+		static std::false_type test_object(...);
+
+		static constexpr bool value = decltype(test_registered<_P>(0))::value
+			&& decltype(test_object<_T>(nullptr))::value
+			&& std::is_base_of<_T, _P>::value;
+	};
+
+	template<typename _T, typename _P, bool _IsConvertible, bool _IsObjectTypeDowncast>
 	struct _caster {
 		static _P* cast(_T* p)
 		{
@@ -60,7 +146,34 @@ protected:
 		}
 	};
 	template<typename _T, typename _P>
-	struct _caster<_T, _P, true> {
+	struct _caster<_T, _P, false, true> {
+		static _P* cast(_T* p)
+		{
+			return nullptr != p && p->get_type_info().is_a(_P::static_type_info()) ? static_cast<_P*>(p) : nullptr;
+		}
+		static const _P* cast(const _T* p)
+		{
+			return nullptr != p && p->get_type_info().is_a(_P::static_type_info()) ? static_cast<const _P*>(p) : nullptr;
+		}
+		static _P& cast(_T& v)
+		{
+			if (!v.get_type_info().is_a(_P::static_type_info()))
+			{
+				throw std::bad_cast();
+			}
+			return static_cast<_P&>(v);
+		}
+		static const _P& cast(const _T& v)
+		{
+			if (!v.get_type_info().is_a(_P::static_type_info()))
+			{
+				throw std::bad_cast();
+			}
+			return static_cast<const _P&>(v);
+		}
+	};
+	template<typename _T, typename _P, bool _IsObjectTypeDowncast>
+	struct _caster<_T, _P, true, _IsObjectTypeDowncast> {
 		static _P* cast(_T* p)
 		{
 			return static_cast<_P*>(p);
@@ -85,13 +198,14 @@ class cast_utils : _cast_utils {
 	
 public:
 	static constexpr bool IsConvertible = std::is_convertible<_T*, _P*>::value;
+	static constexpr bool IsObjectTypeDowncast = _is_object_type_downcast<_T, _P>::value;
 	static _P* cast(_T* p)
 	{
-		return _caster<_T, _P, IsConvertible>::cast(p);
+		return _caster<_T, _P, IsConvertible, IsObjectTypeDowncast>::cast(p);
 	}
 	static _P& cast(_T& v)
 	{
-		return _caster<_T, _P, IsConvertible>::cast(v);
+		return _caster<_T, _P, IsConvertible, IsObjectTypeDowncast>::cast(v);
 	}
 };
 